@@ -0,0 +1,1175 @@
+// LICENSE
+//
+//   This software is dual-licensed to the public domain and under the following
+//   license: you are granted a perpetual, irrevocable license to copy, modify,
+//   publish, and distribute this file as you see fit.
+//
+// NOTES
+//   Compiling
+//     You MUST add '#define FTS_FUZZY_CORPUS_IMPLEMENTATION' before including this header in ONE source file to create implementation.
+//     Requires fts_fuzzy_search.h and fts_fuzzy_match.h. All three implementations must be defined in the same source
+//     file, in the order match, search, corpus, because corpus calls search helpers in fuzzy_internal such as
+//     corpus_offer and folded_subsequence, and search calls match helpers such as fold_case:
+//       #define FTS_FUZZY_MATCH_IMPLEMENTATION
+//       #define FTS_FUZZY_SEARCH_IMPLEMENTATION
+//       #define FTS_FUZZY_CORPUS_IMPLEMENTATION
+//       #include "fts_fuzzy_match.h"
+//       #include "fts_fuzzy_search.h"
+//       #include "fts_fuzzy_corpus.h"
+//
+//   Corpus file
+//     Binary image of a string list that is ready to search. Built once from a text file with one string per line.
+//     Holds a header followed by offset, length, and signature arrays, a blob of null terminated strings, and a second
+//     blob with the same strings folded to lower case. Sections are 8 byte aligned and stored in native byte order.
+//     Loading maps the file read-only. Nothing is parsed or allocated per string.
+//
+//   fuzzy_corpus_write(...)
+//     Writes strings to a corpus file. Returns false if the file can't be written or the strings exceed 4GB.
+//
+//   fuzzy_corpus_build(...)
+//     Reads a text file, one string per line, and writes it as a corpus file. Trailing '\r' is stripped. A line holding
+//     a '\0' byte is cut there, like every string added to a FuzzyCorpus.
+//
+//   FuzzyCorpusView
+//     Non-owning pointers into a corpus. Declared in fts_fuzzy_search.h so its search classes can take one.
+//
+//   FuzzyCorpus
+//     Owning corpus built in memory. Every string is appended to one contiguous blob and to a folded copy. Offsets,
+//     lengths, and signatures are kept in separate arrays, so a scan reads signatures sequentially and only touches
+//     string bytes for strings that pass. Use it instead of std::vector<std::string> for anything searched often.
+//
+//   FuzzyCorpusFile
+//     Memory maps a corpus file and validates its header and section bounds. Every stored length must match the position
+//     of the string's terminator in both blobs, so length based pruning and null terminated scoring see the same string.
+//     That check reads each string once when the file is opened. view() is valid until close().
+//
+//   fuzzy_match_batch(...) / fuzzy_match_top_k(...)
+//     Same results as the versions taking string arrays. Strings are rejected by signature, then by stored length
+//     against the top K threshold, then by a subsequence test on the folded copy, before they are scored.
+//     The folded copy of a string that passes its signature test is prefetched a few strings ahead of the scan.
+//     Passing a FuzzySearchPool splits the scan across its threads. It is the same as FuzzySearchPool::top_k(...).
+//
+//   FuzzyBigramIndex
+//     Optional inverted index for corpora too large to scan per keystroke. Characters are grouped into the same 64
+//     buckets as fuzzy_signature. A string is posted under the pair (a, b) if bucket a appears anywhere before bucket b,
+//     gaps allowed, so "fzy" is posted under (f, z) for "fuzzy". A string that matches "ftw" must be posted under
+//     both (f, t) and (t, w). candidates(...) intersects the posting lists of the pattern's consecutive pairs, shortest
+//     first, which yields a superset of the matches. Patterns shorter than two characters have no pair to look up.
+//     Postings are stored in one array with an offset per pair. memory_bytes() reports the total.
+//     Passing the index to fuzzy_match_top_k(...) scores only the candidates. Results equal the unindexed version.
+//     The index must be built from that same corpus. It returns no results if the index holds a different count.
+//
+//   FuzzyCorpusPartitions
+//     Copy of a corpus laid out by length bucket and by the bucket of its first character, so each partition is one
+//     contiguous run of strings. indices() maps positions in the copy back to the original. Each partition keeps its length range,
+//     the union of its signatures, and the buckets seen in its first fuzzy_partition_lead characters. From those a
+//     partition gets a score bound for a pattern: strings shorter than the pattern can't match, every extra letter costs
+//     the unmatched penalty, and a partition that can't start with the pattern's first character loses the first letter
+//     bonus or pays the full leading letter penalty. Passing the partitions to fuzzy_match_top_k(...) visits partitions
+//     best bound first and stops once no remaining partition can reach the top K threshold. Scores equal fuzzy_match(...).
+//
+//   FuzzyLiveCorpus
+//     Corpus that takes inserts, removals, and updates while it is being searched. Each string gets a stable id, and ids
+//     of removed strings are reused. Strings are appended to a FuzzyCorpus and posted under their bigram pairs, one
+//     growable list per pair, so an insert costs only the string's own bytes and pairs. Removing marks the slot dead and
+//     leaves it in the posting lists, and update(...) is an insert of the new string under the old id plus a removal.
+//     top_k(...) intersects posting lists like FuzzyBigramIndex, skips dead slots, and returns ids. Scores equal fuzzy_match(...).
+//     Once fuzzy_live_compact_min slots are dead and they are over a quarter of the store, a background thread copies
+//     the live strings into a fresh store. It copies in blocks of fuzzy_live_copy_block strings, builds the new posting
+//     lists without holding the lock, replays changes made meanwhile, then swaps stores. Searches and updates only ever
+//     wait for one block or for the replay. compact() starts one by hand, and wait() blocks until it is done.
+
+
+#ifndef FTS_FUZZY_CORPUS_H
+#define FTS_FUZZY_CORPUS_H
+
+
+#include "fts_fuzzy_search.h"
+
+#include <cstddef>  // size_t
+#include <cstdio>   // FILE, fopen, fwrite
+
+// Public interface
+namespace fts {
+
+    const uint32_t fuzzy_corpus_version = 1;
+
+    // Corpus file layout. Every *Start member is a byte offset from the start of the file.
+    struct FuzzyCorpusHeader {
+        char magic[8];              // "FTSCORP" null terminated
+        uint32_t version;           // fuzzy_corpus_version
+        uint32_t count;             // number of strings
+        uint64_t blobSize;          // bytes in each blob including terminators
+        uint64_t offsetsStart;      // uint32_t[count] offset of each string within both blobs
+        uint64_t lengthsStart;      // uint32_t[count] strlen of each string
+        uint64_t signaturesStart;   // uint64_t[count] fuzzy_signature of each string
+        uint64_t blobStart;         // strings as written
+        uint64_t foldedStart;       // strings folded to lower case
+    };
+
+    // Owning in-memory corpus. Same layout as a corpus file.
+    class FuzzyCorpus {
+      public:
+        FuzzyCorpus() {}
+        FuzzyCorpus(char const * const * strings, int count);
+
+        // Returns index of the new string. -1 if the blob would exceed 4GB. A string is cut at its first '\0' so the
+        // stored length always equals strlen.
+        int add(char const * str);
+        int add(char const * str, int length);
+
+        void reserve(int count, size_t blobBytes);
+        void clear();
+
+        int size() const { return (int)offsets.size(); }
+        char const * string(int i) const { return blob.data() + offsets[i]; }
+        char const * folded(int i) const { return foldedBlob.data() + offsets[i]; }
+        int length(int i) const { return (int)lengths[i]; }
+
+        // Valid until the next add, reserve, or clear
+        FuzzyCorpusView view() const;
+
+      private:
+        std::vector<char> blob;
+        std::vector<char> foldedBlob;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> lengths;
+        std::vector<uint64_t> signatures;
+    };
+
+    class FuzzyCorpusFile {
+      public:
+        FuzzyCorpusFile();
+        ~FuzzyCorpusFile();
+
+        FuzzyCorpusFile(FuzzyCorpusFile const &) = delete;
+        FuzzyCorpusFile & operator=(FuzzyCorpusFile const &) = delete;
+
+        // False if the file can't be mapped or isn't a valid corpus
+        bool open(char const * path);
+        void close();
+
+        bool is_open() const { return data != nullptr; }
+        size_t file_size() const { return size; }
+        FuzzyCorpusView const & view() const { return corpus; }
+
+      private:
+        bool validate();
+
+        void const * data;
+        size_t size;
+        FuzzyCorpusView corpus;
+
+#if defined(_WIN32)
+        void * file;                // HANDLE
+        void * mapping;             // HANDLE
+#endif
+    };
+
+    class FuzzyBigramIndex {
+      public:
+        FuzzyBigramIndex() : indexed(0) {}
+        explicit FuzzyBigramIndex(FuzzyCorpusView const & corpus);
+
+        void build(FuzzyCorpusView const & corpus);
+        void clear();
+
+        // Ascending indices of strings that might match pattern. Returns false, leaving outCandidates empty, if the
+        // pattern has no pair to look up and every string is a candidate.
+        bool candidates(char const * pattern, std::vector<int> & outCandidates) const;
+
+        int count() const { return indexed; }
+        size_t posting_count() const { return postings.size(); }
+        size_t memory_bytes() const { return starts.size() * sizeof(uint64_t) + postings.size() * sizeof(uint32_t); }
+
+      private:
+        static const int bucketCount = 64;
+
+        int indexed;
+        std::vector<uint64_t> starts;       // bucketCount * bucketCount + 1. Pair (a, b) is [starts[a*64+b], starts[a*64+b+1])
+        std::vector<uint32_t> postings;     // ascending string indices per pair
+    };
+
+    const int fuzzy_partition_lead = 3;     // characters at the start of a string recorded per partition
+
+    class FuzzyCorpusPartitions {
+      public:
+        struct Partition {
+            int begin;                  // range of positions in strings()
+            int end;
+            int minLength;
+            int maxLength;
+            uint64_t signature;         // union of string signatures
+            uint64_t firstMask;         // buckets of first characters
+            uint64_t leadMask;          // buckets of the first fuzzy_partition_lead characters
+        };
+
+        FuzzyCorpusPartitions() {}
+        explicit FuzzyCorpusPartitions(FuzzyCorpusView const & corpus);
+
+        void build(FuzzyCorpusView const & corpus);
+        void clear();
+
+        int partition_count() const { return (int)partitions.size(); }
+        Partition const & partition(int i) const { return partitions[i]; }
+
+        // Strings in partition order and the original index of each. Ascending indices within a partition.
+        FuzzyCorpus const & strings() const { return sorted; }
+        uint32_t const * indices() const { return order.data(); }
+
+      private:
+        std::vector<Partition> partitions;
+        FuzzyCorpus sorted;
+        std::vector<uint32_t> order;
+    };
+
+    const int fuzzy_live_compact_min = 1024;   // dead slots before a FuzzyLiveCorpus compacts on its own
+    const int fuzzy_live_copy_block = 1024;    // strings copied per lock while compacting
+
+    class FuzzyLiveCorpus {
+      public:
+        FuzzyLiveCorpus();
+        ~FuzzyLiveCorpus();
+
+        FuzzyLiveCorpus(FuzzyLiveCorpus const &) = delete;
+        FuzzyLiveCorpus & operator=(FuzzyLiveCorpus const &) = delete;
+
+        // Returns id of the new string. -1 if the blob would exceed 4GB.
+        int insert(char const * str);
+
+        // False if id isn't live. A failed update leaves the old string in place.
+        bool remove(int id);
+        bool update(int id, char const * str);
+
+        // Results hold ids, ordered best first
+        int top_k(char const * pattern, int k, FuzzyResult * outResults) const;
+
+        // Starts a background compaction. False if one is already running.
+        bool compact();
+        bool compacting() const;
+        void wait();
+
+        int size() const;
+        int slot_count() const;             // live and dead strings still in the store
+        std::string string(int id) const;   // empty if id isn't live
+
+      private:
+        struct Store {
+            Store() : dead(0) {}
+
+            FuzzyCorpus strings;
+            std::vector<uint32_t> ids;                      // slot to id
+            std::vector<uint8_t> alive;
+            std::vector<std::vector<uint32_t>> postings;    // ascending slots per bigram pair, dead ones included
+            int dead;
+        };
+
+        // Require the lock
+        int append(Store & target, char const * str, int length, int id);
+        void kill(int slot);
+        bool start_compaction();
+
+        void compact_store();
+
+        mutable std::mutex mutex;               // guards everything below
+        std::condition_variable finished;
+        Store store;
+        std::vector<int> idSlots;               // id to slot, -1 if free
+        std::vector<int> freeIds;
+        std::vector<int> removedDuring;         // slots killed while compacting
+        bool running;
+        std::thread compactor;
+    };
+
+    static bool fuzzy_corpus_write(char const * path, FuzzyCorpusView const & corpus);
+    static bool fuzzy_corpus_write(char const * path, char const * const * strings, int count);
+    static bool fuzzy_corpus_build(char const * textPath, char const * corpusPath);
+    static int fuzzy_match_batch(char const * pattern, FuzzyCorpusView const & corpus, int * outScores);
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults);
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults, FuzzySearchPool & pool);
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, FuzzyBigramIndex const & index, int k, FuzzyResult * outResults);
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusPartitions const & partitions, int k, FuzzyResult * outResults);
+}
+
+
+#ifdef FTS_FUZZY_CORPUS_IMPLEMENTATION
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>    // CreateFileMappingA, MapViewOfFile
+#else
+    #include <fcntl.h>      // ::open
+    #include <sys/mman.h>   // mmap, munmap
+    #include <sys/stat.h>   // fstat
+    #include <unistd.h>     // ::close
+#endif
+
+namespace fts {
+
+    // Forward declarations for "private" implementation
+    namespace fuzzy_internal {
+        template <typename PairFn> static void for_each_bigram(char const * folded, uint64_t * follows, PairFn && emit);
+        static bool pattern_bigrams(char const * pattern, std::vector<int> & outPairs);
+        static void intersect_postings(std::vector<std::pair<uint32_t const *, uint32_t const *>> & lists, std::vector<int> & outCandidates);
+        static int length_bucket(int length);
+        static int partition_bound(FuzzyPattern const & compiled, FuzzyCorpusPartitions::Partition const & partition);
+        static uint64_t align8(uint64_t offset);
+    }
+
+    // Public interface
+    static bool fuzzy_corpus_write(char const * path, FuzzyCorpusView const & corpus) {
+        using namespace fuzzy_internal;
+
+        uint64_t count = (uint64_t)corpus.count;
+        FuzzyCorpusHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "FTSCORP", 8);
+        header.version = fuzzy_corpus_version;
+        header.count = (uint32_t)count;
+        header.blobSize = corpus.blobSize;
+        header.offsetsStart = align8(sizeof(header));
+        header.lengthsStart = align8(header.offsetsStart + count * sizeof(uint32_t));
+        header.signaturesStart = align8(header.lengthsStart + count * sizeof(uint32_t));
+        header.blobStart = align8(header.signaturesStart + count * sizeof(uint64_t));
+        header.foldedStart = align8(header.blobStart + header.blobSize);
+
+        FILE * file = fopen(path, "wb");
+        if (!file)
+            return false;
+
+        // Writes section at its offset, zero padding the gap before it
+        uint64_t written = 0;
+        auto write = [&](uint64_t start, void const * bytes, size_t length) {
+            static const char zeros[8] = {};
+            bool ok = fwrite(zeros, 1, (size_t)(start - written), file) == start - written && fwrite(bytes, 1, length, file) == length;
+            written = start + length;
+            return ok;
+        };
+
+        bool ok = write(0, &header, sizeof(header))
+            && write(header.offsetsStart, corpus.offsets, (size_t)count * sizeof(uint32_t))
+            && write(header.lengthsStart, corpus.lengths, (size_t)count * sizeof(uint32_t))
+            && write(header.signaturesStart, corpus.signatures, (size_t)count * sizeof(uint64_t))
+            && write(header.blobStart, corpus.blob, corpus.blobSize)
+            && write(header.foldedStart, corpus.foldedBlob, corpus.blobSize);
+
+        return fclose(file) == 0 && ok;
+    }
+
+    static bool fuzzy_corpus_write(char const * path, char const * const * strings, int count) {
+        FuzzyCorpus corpus;
+        for (int i = 0; i < count; ++i)
+            if (corpus.add(strings[i]) < 0)
+                return false;
+
+        return fuzzy_corpus_write(path, corpus.view());
+    }
+
+    static bool fuzzy_corpus_build(char const * textPath, char const * corpusPath) {
+        FILE * file = fopen(textPath, "rb");
+        if (!file)
+            return false;
+
+        // Read whole file then split it into lines
+        std::vector<char> text;
+        char buffer[65536];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            text.insert(text.end(), buffer, buffer + read);
+        fclose(file);
+
+        // Last line may not end in a newline
+        if (!text.empty() && text.back() != '\n')
+            text.push_back('\n');
+
+        FuzzyCorpus corpus;
+        size_t begin = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '\n')
+                continue;
+
+            size_t end = i > begin && text[i - 1] == '\r' ? i - 1 : i;
+            if (corpus.add(text.data() + begin, (int)(end - begin)) < 0)
+                return false;
+            begin = i + 1;
+        }
+
+        return fuzzy_corpus_write(corpusPath, corpus.view());
+    }
+
+    static int fuzzy_match_batch(char const * pattern, FuzzyCorpusView const & corpus, int * outScores) {
+        using namespace fuzzy_internal;
+
+        FuzzyPattern compiled(pattern);
+
+        int matched = 0;
+        for (int i = 0; i < corpus.count; ++i) {
+            // Pull in the folded copy of a string that will pass its signature test a few iterations from now
+            int ahead = i + corpus_prefetch_distance;
+            if (ahead < corpus.count && compiled.might_match(corpus.signatures[ahead]))
+                prefetch(corpus.folded(ahead));
+
+            int score;
+            if (compiled.might_match(corpus.signatures[i])
+                && folded_subsequence(compiled.folded(), corpus.folded(i))
+                && compiled.match(corpus.string(i), score)) {
+                outScores[i] = score;
+                ++matched;
+            }
+            else {
+                outScores[i] = fuzzy_no_match;
+            }
+        }
+
+        return matched;
+    }
+
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults) {
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        FuzzyTopK top(k);
+        fuzzy_internal::corpus_top_k(compiled, corpus, 0, corpus.count, true, top);
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults, FuzzySearchPool & pool) {
+        return pool.top_k(pattern, corpus, k, outResults);
+    }
+
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusView const & corpus, FuzzyBigramIndex const & index, int k, FuzzyResult * outResults) {
+        using namespace fuzzy_internal;
+
+        // Candidates of an index built from another corpus could point past this one
+        if (index.count() != corpus.count)
+            return 0;
+
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        FuzzyTopK top(k);
+        std::vector<int> candidates;
+        if (index.candidates(pattern, candidates)) {
+            int count = (int)candidates.size();
+            for (int i = 0; i < count; ++i) {
+                if (i + corpus_prefetch_distance < count)
+                    prefetch(corpus.folded(candidates[i + corpus_prefetch_distance]));
+                corpus_offer(compiled, corpus, candidates[i], candidates[i], true, top);
+            }
+        }
+        else {
+            corpus_top_k(compiled, corpus, 0, corpus.count, true, top);
+        }
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    static int fuzzy_match_top_k(char const * pattern, FuzzyCorpusPartitions const & partitions, int k, FuzzyResult * outResults) {
+        using namespace fuzzy_internal;
+
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        // Bound every partition that could hold a match then visit best first
+        std::vector<std::pair<int, int>> visit;
+        for (int p = 0; p < partitions.partition_count(); ++p) {
+            auto && partition = partitions.partition(p);
+            if (partition.maxLength >= compiled.length() && compiled.might_match(partition.signature))
+                visit.push_back(std::make_pair(partition_bound(compiled, partition), p));
+        }
+        std::sort(visit.begin(), visit.end(), [](std::pair<int, int> const & a, std::pair<int, int> const & b) { return a.first > b.first; });
+
+        FuzzyTopK top(k);
+        FuzzyCorpusView corpus = partitions.strings().view();
+        uint32_t const * indices = partitions.indices();
+        for (auto && entry : visit) {
+            // Partitions arrive out of index order so an equal score may still win on index
+            int threshold = top.threshold();
+            if (threshold != fuzzy_no_match && entry.first < threshold)
+                break;
+
+            auto && partition = partitions.partition(entry.second);
+            for (int i = partition.begin; i < partition.end; ++i)
+                corpus_offer(compiled, corpus, i, (int)indices[i], false, top);
+        }
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    // FuzzyCorpus
+    FuzzyCorpus::FuzzyCorpus(char const * const * strings, int count) {
+        for (int i = 0; i < count; ++i)
+            add(strings[i]);
+    }
+
+    int FuzzyCorpus::add(char const * str) {
+        return add(str, (int)strlen(str));
+    }
+
+    int FuzzyCorpus::add(char const * str, int length) {
+        // Scorers stop at the terminator, so length based pruning must too
+        char const * terminator = (char const *)memchr(str, '\0', length);
+        if (terminator)
+            length = (int)(terminator - str);
+
+        // Offsets are 32-bit
+        size_t offset = blob.size();
+        if (offset + length + 1 > UINT32_MAX)
+            return -1;
+
+        blob.insert(blob.end(), str, str + length);
+        blob.push_back('\0');
+        for (int i = 0; i < length; ++i)
+            foldedBlob.push_back(fuzzy_internal::fold_case(str[i]));
+        foldedBlob.push_back('\0');
+
+        offsets.push_back((uint32_t)offset);
+        lengths.push_back((uint32_t)length);
+        signatures.push_back(fuzzy_signature(blob.data() + offset));
+        return (int)offsets.size() - 1;
+    }
+
+    void FuzzyCorpus::reserve(int count, size_t blobBytes) {
+        blob.reserve(blobBytes);
+        foldedBlob.reserve(blobBytes);
+        offsets.reserve(count);
+        lengths.reserve(count);
+        signatures.reserve(count);
+    }
+
+    void FuzzyCorpus::clear() {
+        blob.clear();
+        foldedBlob.clear();
+        offsets.clear();
+        lengths.clear();
+        signatures.clear();
+    }
+
+    FuzzyCorpusView FuzzyCorpus::view() const {
+        FuzzyCorpusView corpus;
+        corpus.count = size();
+        corpus.blobSize = blob.size();
+        corpus.blob = blob.data();
+        corpus.foldedBlob = foldedBlob.data();
+        corpus.offsets = offsets.data();
+        corpus.lengths = lengths.data();
+        corpus.signatures = signatures.data();
+        return corpus;
+    }
+
+    // FuzzyBigramIndex
+    FuzzyBigramIndex::FuzzyBigramIndex(FuzzyCorpusView const & corpus)
+        : indexed(0)
+    {
+        build(corpus);
+    }
+
+    void FuzzyBigramIndex::build(FuzzyCorpusView const & corpus) {
+        using namespace fuzzy_internal;
+
+        const int pairCount = bucketCount * bucketCount;
+        uint64_t follows[bucketCount] = {};
+
+        // Count postings per pair, turn counts into starts, then fill. Strings are visited in order so lists are sorted.
+        starts.assign(pairCount + 1, 0);
+        for (int i = 0; i < corpus.count; ++i)
+            for_each_bigram(corpus.folded(i), follows, [&](int pair) { ++starts[pair + 1]; });
+
+        for (int pair = 0; pair < pairCount; ++pair)
+            starts[pair + 1] += starts[pair];
+
+        postings.resize((size_t)starts[pairCount]);
+        std::vector<uint64_t> next(starts.begin(), starts.end() - 1);
+        for (int i = 0; i < corpus.count; ++i)
+            for_each_bigram(corpus.folded(i), follows, [&](int pair) { postings[(size_t)next[pair]++] = (uint32_t)i; });
+
+        indexed = corpus.count;
+    }
+
+    void FuzzyBigramIndex::clear() {
+        indexed = 0;
+        starts.clear();
+        postings.clear();
+    }
+
+    bool FuzzyBigramIndex::candidates(char const * pattern, std::vector<int> & outCandidates) const {
+        using namespace fuzzy_internal;
+
+        outCandidates.clear();
+
+        std::vector<int> pairs;
+        if (!pattern_bigrams(pattern, pairs) || starts.empty())
+            return false;
+
+        std::vector<std::pair<uint32_t const *, uint32_t const *>> lists;
+        for (int pair : pairs)
+            lists.emplace_back(postings.data() + starts[pair], postings.data() + starts[pair + 1]);
+
+        intersect_postings(lists, outCandidates);
+        return true;
+    }
+
+    // FuzzyCorpusPartitions
+    FuzzyCorpusPartitions::FuzzyCorpusPartitions(FuzzyCorpusView const & corpus) {
+        build(corpus);
+    }
+
+    void FuzzyCorpusPartitions::build(FuzzyCorpusView const & corpus) {
+        using namespace fuzzy_internal;
+
+        // Key is length bucket then first character bucket. Empty strings share the first character bucket of '\0'.
+        const int firstBuckets = 64;
+        std::vector<int> keys(corpus.count);
+        int keyCount = 0;
+        for (int i = 0; i < corpus.count; ++i) {
+            keys[i] = length_bucket(corpus.length(i)) * firstBuckets + char_bit(*corpus.folded(i));
+            if (keys[i] + 1 > keyCount)
+                keyCount = keys[i] + 1;
+        }
+
+        // Counting sort keeps indices ascending within each key
+        std::vector<int> starts(keyCount + 1, 0);
+        for (int key : keys)
+            ++starts[key + 1];
+        for (int key = 0; key < keyCount; ++key)
+            starts[key + 1] += starts[key];
+
+        order.resize(corpus.count);
+        std::vector<int> next(starts.begin(), starts.end() - 1);
+        for (int i = 0; i < corpus.count; ++i)
+            order[next[keys[i]]++] = (uint32_t)i;
+
+        sorted.clear();
+        sorted.reserve(corpus.count, corpus.blobSize);
+        for (int i = 0; i < corpus.count; ++i)
+            sorted.add(corpus.string((int)order[i]), corpus.length((int)order[i]));
+
+        partitions.clear();
+        for (int key = 0; key < keyCount; ++key) {
+            if (starts[key] == starts[key + 1])
+                continue;
+
+            Partition partition;
+            partition.begin = starts[key];
+            partition.end = starts[key + 1];
+            partition.minLength = INT_MAX;
+            partition.maxLength = 0;
+            partition.signature = 0;
+            partition.firstMask = 0;
+            partition.leadMask = 0;
+            for (int i = partition.begin; i < partition.end; ++i) {
+                int length = sorted.length(i);
+                char const * folded = sorted.folded(i);
+                partition.minLength = length < partition.minLength ? length : partition.minLength;
+                partition.maxLength = length > partition.maxLength ? length : partition.maxLength;
+                partition.signature |= corpus.signatures[order[i]];
+                if (length > 0)
+                    partition.firstMask |= uint64_t(1) << char_bit(folded[0]);
+                for (int c = 0; c < fuzzy_partition_lead && c < length; ++c)
+                    partition.leadMask |= uint64_t(1) << char_bit(folded[c]);
+            }
+            partitions.push_back(partition);
+        }
+    }
+
+    void FuzzyCorpusPartitions::clear() {
+        partitions.clear();
+        sorted.clear();
+        order.clear();
+    }
+
+    // FuzzyLiveCorpus
+    FuzzyLiveCorpus::FuzzyLiveCorpus()
+        : running(false)
+    {
+        store.postings.resize(64 * 64);
+    }
+
+    FuzzyLiveCorpus::~FuzzyLiveCorpus() {
+        wait();
+    }
+
+    int FuzzyLiveCorpus::insert(char const * str) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        int id = freeIds.empty() ? (int)idSlots.size() : freeIds.back();
+        int slot = append(store, str, (int)strlen(str), id);
+        if (slot < 0)
+            return -1;
+
+        if (id == (int)idSlots.size())
+            idSlots.push_back(slot);
+        else {
+            freeIds.pop_back();
+            idSlots[id] = slot;
+        }
+        return id;
+    }
+
+    bool FuzzyLiveCorpus::remove(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id < 0 || id >= (int)idSlots.size() || idSlots[id] < 0)
+            return false;
+
+        kill(idSlots[id]);
+        idSlots[id] = -1;
+        freeIds.push_back(id);
+
+        if (store.dead >= fuzzy_live_compact_min && store.dead * 4 > store.strings.size())
+            start_compaction();
+        return true;
+    }
+
+    bool FuzzyLiveCorpus::update(int id, char const * str) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id < 0 || id >= (int)idSlots.size() || idSlots[id] < 0)
+            return false;
+
+        // Append first so a failure keeps the old string
+        int slot = append(store, str, (int)strlen(str), id);
+        if (slot < 0)
+            return false;
+
+        kill(idSlots[id]);
+        idSlots[id] = slot;
+
+        if (store.dead >= fuzzy_live_compact_min && store.dead * 4 > store.strings.size())
+            start_compaction();
+        return true;
+    }
+
+    int FuzzyLiveCorpus::top_k(char const * pattern, int k, FuzzyResult * outResults) const {
+        using namespace fuzzy_internal;
+
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        std::vector<int> pairs;
+        bool indexed = pattern_bigrams(pattern, pairs);
+
+        // Slots aren't in id order so a tie with the threshold may still win
+        FuzzyTopK top(k);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            FuzzyCorpusView corpus = store.strings.view();
+
+            if (indexed) {
+                std::vector<std::pair<uint32_t const *, uint32_t const *>> lists;
+                for (int pair : pairs) {
+                    std::vector<uint32_t> const & list = store.postings[pair];
+                    lists.emplace_back(list.data(), list.data() + list.size());
+                }
+
+                std::vector<int> candidates;
+                intersect_postings(lists, candidates);
+                for (int slot : candidates)
+                    if (store.alive[slot])
+                        corpus_offer(compiled, corpus, slot, (int)store.ids[slot], false, top);
+            }
+            else {
+                for (int slot = 0; slot < corpus.count; ++slot)
+                    if (store.alive[slot])
+                        corpus_offer(compiled, corpus, slot, (int)store.ids[slot], false, top);
+            }
+        }
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    bool FuzzyLiveCorpus::compact() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return start_compaction();
+    }
+
+    bool FuzzyLiveCorpus::compacting() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+    void FuzzyLiveCorpus::wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return !running; });
+
+        // Thread has nothing left to do once running is cleared, so joining under the lock can't deadlock
+        if (compactor.joinable())
+            compactor.join();
+    }
+
+    int FuzzyLiveCorpus::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return store.strings.size() - store.dead;
+    }
+
+    int FuzzyLiveCorpus::slot_count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return store.strings.size();
+    }
+
+    std::string FuzzyLiveCorpus::string(int id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id < 0 || id >= (int)idSlots.size() || idSlots[id] < 0)
+            return std::string();
+
+        int slot = idSlots[id];
+        return std::string(store.strings.string(slot), (size_t)store.strings.length(slot));
+    }
+
+    // Adds str to target and posts it. Returns its slot, or -1 if the blob is full.
+    int FuzzyLiveCorpus::append(Store & target, char const * str, int length, int id) {
+        int slot = target.strings.add(str, length);
+        if (slot < 0)
+            return -1;
+
+        target.ids.push_back((uint32_t)id);
+        target.alive.push_back(1);
+
+        uint64_t follows[64] = {};
+        fuzzy_internal::for_each_bigram(target.strings.folded(slot), follows, [&](int pair) { target.postings[pair].push_back((uint32_t)slot); });
+        return slot;
+    }
+
+    void FuzzyLiveCorpus::kill(int slot) {
+        store.alive[slot] = 0;
+        ++store.dead;
+        if (running)
+            removedDuring.push_back(slot);
+    }
+
+    bool FuzzyLiveCorpus::start_compaction() {
+        if (running)
+            return false;
+
+        // A finished thread only has to return
+        if (compactor.joinable())
+            compactor.join();
+
+        running = true;
+        removedDuring.clear();
+        compactor = std::thread([this] { compact_store(); });
+        return true;
+    }
+
+    // Runs on the compaction thread
+    void FuzzyLiveCorpus::compact_store() {
+        Store fresh;
+        fresh.postings.resize(64 * 64);
+        std::vector<int> movedTo;
+        std::vector<int> freshSlots;
+        int limit;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            limit = store.strings.size();
+        }
+        movedTo.assign(limit, -1);
+
+        // Copy live strings below limit a block at a time. Slots below limit never move until the swap.
+        for (int begin = 0; begin < limit; begin += fuzzy_live_copy_block) {
+            std::lock_guard<std::mutex> lock(mutex);
+            int end = std::min(begin + fuzzy_live_copy_block, limit);
+            for (int slot = begin; slot < end; ++slot) {
+                if (!store.alive[slot])
+                    continue;
+
+                int id = (int)store.ids[slot];
+                movedTo[slot] = fresh.strings.add(store.strings.string(slot), store.strings.length(slot));
+                fresh.ids.push_back((uint32_t)id);
+                fresh.alive.push_back(1);
+                if (id >= (int)freshSlots.size())
+                    freshSlots.resize(id + 1, -1);
+                freshSlots[id] = movedTo[slot];
+            }
+        }
+
+        // Posting lists are the bulk of the work and only read the fresh copy
+        uint64_t follows[64] = {};
+        for (int slot = 0; slot < fresh.strings.size(); ++slot)
+            fuzzy_internal::for_each_bigram(fresh.strings.folded(slot), follows, [&](int pair) { fresh.postings[pair].push_back((uint32_t)slot); });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // Replay removals of copied slots, then append everything inserted since limit. An id removed and reused
+            // meanwhile is cleared by the first pass and set again by the second.
+            freshSlots.resize(idSlots.size(), -1);
+            for (int slot : removedDuring) {
+                if (slot >= limit || movedTo[slot] < 0)
+                    continue;
+
+                int moved = movedTo[slot];
+                fresh.alive[moved] = 0;
+                ++fresh.dead;
+                freshSlots[fresh.ids[moved]] = -1;
+            }
+
+            for (int slot = limit; slot < store.strings.size(); ++slot) {
+                if (!store.alive[slot])
+                    continue;
+
+                int id = (int)store.ids[slot];
+                freshSlots[id] = append(fresh, store.strings.string(slot), store.strings.length(slot), id);
+            }
+
+            std::swap(store, fresh);
+            idSlots.swap(freshSlots);
+            removedDuring.clear();
+        }
+
+        // Old store is freed without the lock
+        fresh = Store();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        finished.notify_all();
+    }
+
+    // FuzzyCorpusFile
+    FuzzyCorpusFile::FuzzyCorpusFile()
+        : data(nullptr)
+        , size(0)
+#if defined(_WIN32)
+        , file(INVALID_HANDLE_VALUE)
+        , mapping(nullptr)
+#endif
+    {
+        memset(&corpus, 0, sizeof(corpus));
+    }
+
+    FuzzyCorpusFile::~FuzzyCorpusFile() {
+        close();
+    }
+
+    bool FuzzyCorpusFile::open(char const * path) {
+        close();
+
+#if defined(_WIN32)
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        // Mapping stays valid after the descriptor is closed
+        void * mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+
+        data = mapped;
+        size = (size_t)info.st_size;
+#endif
+
+        if (!data || !validate()) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void FuzzyCorpusFile::close() {
+#if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data)
+            munmap(const_cast<void *>(data), size);
+#endif
+
+        data = nullptr;
+        size = 0;
+        memset(&corpus, 0, sizeof(corpus));
+    }
+
+    // Checks every section lies inside the file so a truncated or foreign file can't be read out of bounds
+    bool FuzzyCorpusFile::validate() {
+        if (size < sizeof(FuzzyCorpusHeader))
+            return false;
+
+        FuzzyCorpusHeader const & header = *(FuzzyCorpusHeader const *)data;
+        if (memcmp(header.magic, "FTSCORP", 8) != 0 || header.version != fuzzy_corpus_version || header.count > INT_MAX)
+            return false;
+
+        auto fits = [&](uint64_t start, uint64_t bytes) { return start % 8 == 0 && start <= size && bytes <= size - start; };
+        uint64_t count = header.count;
+        if (!fits(header.offsetsStart, count * sizeof(uint32_t)) || !fits(header.lengthsStart, count * sizeof(uint32_t))
+            || !fits(header.signaturesStart, count * sizeof(uint64_t)) || !fits(header.blobStart, header.blobSize)
+            || !fits(header.foldedStart, header.blobSize))
+            return false;
+
+        char const * bytes = (char const *)data;
+        corpus.count = (int)header.count;
+        corpus.blobSize = (size_t)header.blobSize;
+        corpus.blob = bytes + header.blobStart;
+        corpus.foldedBlob = bytes + header.foldedStart;
+        corpus.offsets = (uint32_t const *)(bytes + header.offsetsStart);
+        corpus.lengths = (uint32_t const *)(bytes + header.lengthsStart);
+        corpus.signatures = (uint64_t const *)(bytes + header.signaturesStart);
+
+        // Each string must end inside the blob and its length must equal strlen in both blobs. A '\0' inside a string
+        // would make length based pruning disagree with the null terminated scorers.
+        for (int i = 0; i < corpus.count; ++i) {
+            uint32_t offset = corpus.offsets[i];
+            uint32_t length = corpus.lengths[i];
+            uint64_t end = (uint64_t)offset + length;
+            if (length > INT_MAX || end >= header.blobSize || corpus.blob[end] != '\0' || corpus.foldedBlob[end] != '\0')
+                return false;
+            if (memchr(corpus.blob + offset, '\0', length) || memchr(corpus.foldedBlob + offset, '\0', length))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Private implementation
+    // Calls emit(a * 64 + b) once for every bucket pair where a appears before b in folded.
+    // follows[b] collects buckets seen before an occurrence of b. It must be all zero and is left all zero.
+    template <typename PairFn>
+    static void fuzzy_internal::for_each_bigram(char const * folded, uint64_t * follows, PairFn && emit) {
+        uint64_t seen = 0;
+        uint64_t touched = 0;
+        for (; *folded != '\0'; ++folded) {
+            int bucket = char_bit(*folded);
+            follows[bucket] |= seen;
+            touched |= uint64_t(1) << bucket;
+            seen |= uint64_t(1) << bucket;
+        }
+
+        while (touched) {
+            int b = count_trailing_zeros(touched);
+            touched &= touched - 1;
+            for (uint64_t before = follows[b]; before; before &= before - 1)
+                emit(count_trailing_zeros(before) * 64 + b);
+            follows[b] = 0;
+        }
+    }
+
+    // Distinct bucket pairs of consecutive pattern characters. False if there are none.
+    static bool fuzzy_internal::pattern_bigrams(char const * pattern, std::vector<int> & outPairs) {
+        outPairs.clear();
+        int prev = -1;
+        while (*pattern != '\0') {
+            int bucket = char_bit(fold_case(*pattern++));
+            if (prev >= 0)
+                outPairs.push_back(prev * 64 + bucket);
+            prev = bucket;
+        }
+
+        std::sort(outPairs.begin(), outPairs.end());
+        outPairs.erase(std::unique(outPairs.begin(), outPairs.end()), outPairs.end());
+        return !outPairs.empty();
+    }
+
+    // Ascending values present in every list. Needs at least one list, each ascending.
+    static void fuzzy_internal::intersect_postings(std::vector<std::pair<uint32_t const *, uint32_t const *>> & lists, std::vector<int> & outCandidates) {
+        typedef std::pair<uint32_t const *, uint32_t const *> List;
+
+        // Shortest list first keeps every intermediate result small
+        std::sort(lists.begin(), lists.end(), [](List const & a, List const & b) { return a.second - a.first < b.second - b.first; });
+        outCandidates.assign(lists[0].first, lists[0].second);
+
+        // Remaining lists are longer so each survivor is found by binary search from the last position
+        for (size_t p = 1; p < lists.size() && !outCandidates.empty(); ++p) {
+            uint32_t const * list = lists[p].first;
+            uint32_t const * listEnd = lists[p].second;
+
+            size_t kept = 0;
+            for (int candidate : outCandidates) {
+                list = std::lower_bound(list, listEnd, (uint32_t)candidate);
+                if (list == listEnd)
+                    break;
+                if (*list == (uint32_t)candidate)
+                    outCandidates[kept++] = candidate;
+            }
+            outCandidates.resize(kept);
+        }
+    }
+
+    // Exact lengths up to 16 then four buckets per doubling
+    static int fuzzy_internal::length_bucket(int length) {
+        if (length < 16)
+            return length;
+
+        int log = 4;
+        while (log < 30 && (length >> (log + 1)) != 0)
+            ++log;
+        return 16 + (log - 4) * 4 + ((length >> (log - 2)) & 3);
+    }
+
+    // Same terms as fuzzy_score_upper_bound but the first match is limited by where the pattern's first character
+    // can appear in this partition
+    static int fuzzy_internal::partition_bound(FuzzyPattern const & compiled, FuzzyCorpusPartitions::Partition const & partition) {
+        typedef FuzzyDefaultScoring Policy;
+
+        int camel = Policy::camel_bonus;
+        int separator = Policy::separator_bonus;
+        int bestPositionBonus = camel > separator ? camel : separator;
+        int maxLeading = Policy::max_leading_letter_penalty;
+        int generalFirst = Policy::leading_letter_penalty + bestPositionBonus;
+        if (generalFirst < maxLeading + bestPositionBonus)
+            generalFirst = maxLeading + bestPositionBonus;
+
+        // Best possible contribution of the first match
+        uint64_t first = uint64_t(1) << char_bit(compiled.folded()[0]);
+        int firstBonus;
+        if (partition.leadMask & first) {
+            firstBonus = generalFirst;
+            if ((partition.firstMask & first) && Policy::first_letter_bonus > firstBonus)
+                firstBonus = Policy::first_letter_bonus;
+        }
+        else {
+            int leading = Policy::leading_letter_penalty * fuzzy_partition_lead;
+            firstBonus = (leading > maxLeading ? leading : maxLeading) + bestPositionBonus;
+        }
+
+        int patternLen = compiled.length();
+        int strLen = partition.minLength > patternLen ? partition.minLength : patternLen;
+        return 100 + firstBonus + (patternLen - 1) * (Policy::sequential_bonus + bestPositionBonus) + Policy::unmatched_letter_penalty * (strLen - patternLen);
+    }
+
+    static uint64_t fuzzy_internal::align8(uint64_t offset) {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+} // namespace fts
+
+#endif // FTS_FUZZY_CORPUS_IMPLEMENTATION
+
+#endif // FTS_FUZZY_CORPUS_H
@@ -5,6 +5,10 @@
 //   publish, and distribute this file as you see fit.
 //
 // VERSION 
+//   0.3.0  (2026-10-17)  fuzzy_match_optimal, batch matching, signatures, FuzzyPattern, SIMD scans, UTF-8, scoring
+//                        policies, match masks, and length overloads. Adds fts_fuzzy_search.h for top K, pooled,
+//                        incremental, multi-pattern, and async search, and fts_fuzzy_corpus.h for corpus files,
+//                        bigram index, partitions, and live corpus.
 //   0.2.0  (2017-02-18)  Scored matches perform exhaustive search for best score
 //   0.1.0  (2016-03-28)  Initial release
 //
@@ -18,30 +22,260 @@
 //   fuzzy_match_simple(...)
 //     Returns true if each character in pattern is found sequentially within str
 //
+//     Uses SSE2 or AVX2 when the compiler targets them to jump to the next occurrence of each pattern character.
+//     Define FTS_FUZZY_MATCH_NO_SIMD to force the scalar loop. The vector scan reads past '\0' within an aligned block,
+//     so it is excluded from AddressSanitizer instrumentation when that is enabled.
+//
 //   fuzzy_match(...)
 //     Returns true if pattern is found AND calculates a score.
 //     Performs exhaustive search via recursion to find all possible matches and match with highest score.
 //     Scores values have no intrinsic meaning. Possible score range is not normalized and varies with pattern.
 //     Recursion is limited internally (default=10) to prevent degenerate cases (pattern="aaaaaa" str="aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa")
-//     Uses uint8_t for match indices. Therefore patterns are limited to 256 characters.
+//     Patterns are limited to 256 characters. Strings may be any length.
+//     Match indices are written as uint8_t, uint16_t, or uint32_t depending on the overload. Scores never depend on the
+//     index type, but indices that don't fit wrap. Pass uint16_t or uint32_t buffers if you need indices for strings
+//     longer than 256 characters.
+//     Recursion frames share one scratch arena of 2 * patternLen indices per level. Short patterns keep it on the stack.
 //     Score system should be tuned for YOUR use case. Words, sentences, file names, or method names all prefer different tuning.
+//
+//   Strings with a length
+//     fuzzy_match_simple(pattern, str, strLen) and fuzzy_match(pattern, str, strLen, outScore, ...) read exactly strLen
+//     bytes of str and never look for a terminator, so they can match strings inside a larger buffer such as a mapped
+//     file or a log line. pattern is still null terminated. When compiled as C++17 std::string_view overloads take both.
+//
+//   FuzzyMatchMask
+//     Match positions as a 128-bit mask instead of an index buffer. Bit i is set if str[i] was matched. Positions from
+//     128 on aren't recorded but the score is still correct. Overloads of fuzzy_match(...), fuzzy_match_optimal(...), and
+//     FuzzyPattern::match(...) fill one. When searching many strings keep only scores and recompute positions for the
+//     results actually displayed. The recomputed positions are those of fuzzy_match(...) for that string.
+//
+//   Scoring policies
+//     fuzzy_match<Policy>(...), fuzzy_match_optimal<Policy>(...), fuzzy_score_upper_bound<Policy>(...), and
+//     FuzzyPattern::match<Policy>(...) take weights and separators from Policy at compile time. Functions without a
+//     Policy use FuzzyDefaultScoring. FuzzyPathScoring, FuzzyIdentifierScoring, and FuzzyProseScoring are provided.
+//     Make your own by deriving from FuzzyDefaultScoring and hiding the members you want to change. Separators must
+//     not be lower case letters. Batch, signature, UTF-8, and search functions always use FuzzyDefaultScoring.
+//
+//   fuzzy_score_upper_bound(...)
+//     Highest score any match of a pattern with patternLen characters can reach in a string with strLen characters.
+//     Assumes every match gets the biggest bonus available. Used to skip strings that can't reach a score of interest.
+//
+//   fuzzy_match_batch(...)
+//     Scores one pattern against an array of strings. Same scores as calling fuzzy_match(...) per string.
+//     Pattern is folded and analyzed once. Strings that don't contain the first pattern character are skipped quickly.
+//     Writes fuzzy_no_match into outScores for strings that don't match. Returns number of matched strings.
+//
+//   fuzzy_match_optimal_batch(...)
+//     Same as fuzzy_match_batch(...) but with fuzzy_match_optimal(...) scores. Strings that pass the subsequence test are
+//     queued and scored several at a time. Each 16-bit SIMD lane runs the dynamic programming scorer for one string so
+//     SSE2 scores 8 strings per step and AVX2 scores 16. Strings in a group are padded to the longest one, so lists of
+//     similar length strings gain the most. Without SIMD each string goes through fuzzy_match_optimal(...) instead.
+//
+//   fuzzy_signature(...)
+//     Returns a 64-bit mask of character classes present in str. a-z, 0-9, and common separators get one bit each.
+//     Compute once per string and store alongside it. A string can only match a pattern if its signature covers the
+//     pattern's signature. Testing that is a single AND which rejects most strings before they are scanned.
+//
+//   FuzzyPattern
+//     Pattern compiled once for repeated queries. Caches folded characters, a bitmask of characters in the pattern,
+//     and a lookup table for its first character. match(...) overloads mirror fuzzy_match_simple and fuzzy_match.
+//     match(str, outScore, minScore) returns false as soon as the score can't reach minScore. Recursive branches that
+//     can't reach minScore aren't scored but still count towards the recursion limit. Therefore any score it returns
+//     equals fuzzy_match(...) for the same string, and it returns false exactly when that score is below minScore.
+//
+//     match_bit_parallel(str) answers the same question as match(str) with a Shift-And style state machine. Bit i of
+//     the state is set once the first i+1 pattern characters have been found. Each byte of str costs one table load and
+//     a few word operations with no data dependent branches. Patterns longer than 64 characters fall back to match(str).
+//     With SSE2/AVX2 match(str) usually wins because it skips whole vectors at a time. Without them match(str) uses the
+//     bit parallel kernel since it beats the byte loop.
+//
+//   fuzzy_match_utf8(...)
+//     Same score system as fuzzy_match(...) but pattern and str are decoded as UTF-8. Scores are per code point.
+//     Latin-1, Latin Extended-A, Greek, and Cyrillic letters are case folded and take part in camel case bonuses.
+//     Final sigma folds to sigma. A leading byte order mark is skipped in pattern and str. Invalid sequences decode as
+//     single bytes. Match indices are byte offsets.
+//     When both strings are pure ASCII it calls fuzzy_match(...) directly. Result is identical and nothing is decoded.
+//     fuzzy_match_simple_utf8(...) does the same for fuzzy_match_simple(...).
+//
+//   fuzzy_match_optimal(...)
+//     Same interface and score system as fuzzy_match(...) but computes the provably best score.
+//     Uses dynamic programming over pattern x str instead of recursion. O(pattern * str) time, no recursion limit.
+//     Score-only version keeps one rolling column per pattern character. Version with matches stores the full table.
 
 
 #ifndef FTS_FUZZY_MATCH_H
 #define FTS_FUZZY_MATCH_H
 
 
-#include <cstdint> // uint8_t
-#include <ctype.h> // ::tolower, ::toupper
-#include <cstring> // memcpy
+#include <cstdint> // uint8_t, uint16_t, uint32_t
+#include <cstring> // memcpy, strlen
+#include <cstdlib> // malloc, free
+#include <climits> // INT_MIN
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    #define FTS_FUZZY_MATCH_STRING_VIEW
+    #include <string_view> // std::string_view
+#endif
 
 #include <cstdio>
 
+// SIMD selected at compile time
+#if !defined(FTS_FUZZY_MATCH_NO_SIMD)
+    #if defined(__AVX2__)
+        #define FTS_FUZZY_MATCH_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define FTS_FUZZY_MATCH_SSE2
+        #include <emmintrin.h>
+    #endif
+
+    #if defined(_MSC_VER) && (defined(FTS_FUZZY_MATCH_AVX2) || defined(FTS_FUZZY_MATCH_SSE2))
+        #include <intrin.h> // _BitScanForward
+    #endif
+#endif
+
+// Unbounded SIMD scans read whole aligned blocks past '\0' on purpose. AddressSanitizer can't tell that from a real
+// overflow so those functions opt out of it.
+#if defined(__SANITIZE_ADDRESS__)
+    #define FTS_FUZZY_MATCH_ASAN
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define FTS_FUZZY_MATCH_ASAN
+    #endif
+#endif
+
+#if defined(FTS_FUZZY_MATCH_ASAN) && (defined(__GNUC__) || defined(__clang__))
+    #define FTS_FUZZY_MATCH_NO_ASAN __attribute__((no_sanitize_address))
+#elif defined(FTS_FUZZY_MATCH_ASAN) && defined(_MSC_VER)
+    #define FTS_FUZZY_MATCH_NO_ASAN __declspec(no_sanitize_address)
+#else
+    #define FTS_FUZZY_MATCH_NO_ASAN
+#endif
+
 // Public interface
 namespace fts {
+    struct FuzzyMatchMask;
+
     static bool fuzzy_match_simple(char const * pattern, char const * str);
     static bool fuzzy_match(char const * pattern, char const * str, int & outScore);
     static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint8_t * matches, int maxMatches);
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint16_t * matches, int maxMatches);
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches);
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, FuzzyMatchMask & outMask);
+    static bool fuzzy_match_simple(char const * pattern, char const * str, int strLen);
+    static bool fuzzy_match(char const * pattern, char const * str, int strLen, int & outScore);
+    static bool fuzzy_match(char const * pattern, char const * str, int strLen, int & outScore, uint32_t * matches, int maxMatches);
+#if defined(FTS_FUZZY_MATCH_STRING_VIEW)
+    static bool fuzzy_match_simple(std::string_view pattern, std::string_view str);
+    static bool fuzzy_match(std::string_view pattern, std::string_view str, int & outScore);
+    static bool fuzzy_match(std::string_view pattern, std::string_view str, int & outScore, uint32_t * matches, int maxMatches);
+#endif
+    static bool fuzzy_match_simple_utf8(char const * pattern, char const * str);
+    static bool fuzzy_match_utf8(char const * pattern, char const * str, int & outScore);
+    static bool fuzzy_match_utf8(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches);
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore);
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint8_t * matches, int maxMatches);
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint16_t * matches, int maxMatches);
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches);
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, FuzzyMatchMask & outMask);
+    static int fuzzy_match_batch(char const * pattern, char const * const * candidates, int count, int * outScores);
+    static int fuzzy_match_batch(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int * outScores);
+    static int fuzzy_match_optimal_batch(char const * pattern, char const * const * candidates, int count, int * outScores);
+    static uint64_t fuzzy_signature(char const * str);
+    static int fuzzy_score_upper_bound(int patternLen, int strLen);
+
+    // Same as above with scoring policy chosen at compile time. See FuzzyDefaultScoring.
+    template <typename Policy> static bool fuzzy_match(char const * pattern, char const * str, int & outScore);
+    template <typename Policy, typename IndexT> static bool fuzzy_match(char const * pattern, char const * str, int & outScore, IndexT * matches, int maxMatches);
+    template <typename Policy> static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore);
+    template <typename Policy, typename IndexT> static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, IndexT * matches, int maxMatches);
+    template <typename Policy> static int fuzzy_score_upper_bound(int patternLen, int strLen);
+
+    const int fuzzy_no_match = INT_MIN;             // score written by batch functions for strings that don't match
+
+    // Matched positions of a string, one bit per byte. Positions from 128 on aren't recorded.
+    struct FuzzyMatchMask {
+        uint64_t bits[2];
+
+        bool test(int i) const { return i >= 0 && i < 128 && ((bits[i >> 6] >> (i & 63)) & 1) != 0; }
+    };
+
+    // Score weights and separators used by fuzzy_match(...). Functions without a Policy argument use this one.
+    struct FuzzyDefaultScoring {
+        static constexpr int sequential_bonus = 15;            // bonus for adjacent matches
+        static constexpr int separator_bonus = 30;             // bonus if match occurs after a separator
+        static constexpr int camel_bonus = 30;                 // bonus if match is uppercase and prev is lower
+        static constexpr int first_letter_bonus = 15;          // bonus if the first letter is matched
+
+        static constexpr int leading_letter_penalty = -5;      // penalty applied for every letter in str before the first match
+        static constexpr int max_leading_letter_penalty = -15; // maximum penalty for leading letters
+        static constexpr int unmatched_letter_penalty = -1;    // penalty for every letter that doesn't matter
+
+        // '_' and ' '
+        static bool is_separator(char c);
+        static bool is_separator(uint32_t c);
+    };
+
+    // File paths. Directory, extension, and word separators all start a new word.
+    struct FuzzyPathScoring : FuzzyDefaultScoring {
+        static constexpr bool is_separator(uint32_t c) { return c == '/' || c == '\\' || c == '.' || c == '_' || c == '-' || c == ' '; }
+    };
+
+    // Source code identifiers. Scope and member access split words too. Runs of adjacent matches are worth more.
+    struct FuzzyIdentifierScoring : FuzzyDefaultScoring {
+        static constexpr int sequential_bonus = 20;
+        static constexpr bool is_separator(uint32_t c) { return c == '_' || c == '-' || c == ':' || c == '.'; }
+    };
+
+    // Sentences and titles. Capitals don't start words and matches can begin anywhere, so leading letters cost little.
+    struct FuzzyProseScoring : FuzzyDefaultScoring {
+        static constexpr int camel_bonus = 0;
+        static constexpr int leading_letter_penalty = -1;
+        static constexpr int max_leading_letter_penalty = -5;
+        static constexpr bool is_separator(uint32_t c) {
+            return c == ' ' || c == '-' || c == ',' || c == '.' || c == ';' || c == ':' || c == '\'' || c == '"' || c == '(' || c == '/';
+        }
+    };
+
+    class FuzzyPattern {
+      public:
+        explicit FuzzyPattern(char const * pattern);
+
+        bool match(char const * str) const;
+        bool match(char const * str, int & outScore) const;
+        bool match(char const * str, int & outScore, uint8_t * matches, int maxMatches) const;
+        bool match(char const * str, int & outScore, uint16_t * matches, int maxMatches) const;
+        bool match(char const * str, int & outScore, uint32_t * matches, int maxMatches) const;
+        bool match(char const * str, int & outScore, FuzzyMatchMask & outMask) const;
+        bool match(char const * str, int & outScore, int minScore) const;
+        bool match_optimal(char const * str, int & outScore) const;
+        bool match_optimal(char const * str, int & outScore, uint8_t * matches, int maxMatches) const;
+        bool match_optimal(char const * str, int & outScore, uint16_t * matches, int maxMatches) const;
+        bool match_optimal(char const * str, int & outScore, uint32_t * matches, int maxMatches) const;
+        bool match_optimal(char const * str, int & outScore, FuzzyMatchMask & outMask) const;
+        bool match_optimal(char const * str, int & outScore, int minScore) const;
+        template <typename Policy> bool match(char const * str, int & outScore) const;
+        template <typename Policy> bool match_optimal(char const * str, int & outScore) const;
+        bool match_bit_parallel(char const * str) const;
+        bool match_bit_parallel(char const * str, int strLen) const;
+
+        // False if a string with this fuzzy_signature can not possibly match
+        bool might_match(uint64_t signature) const { return (signature & patternMask) == patternMask; }
+
+        bool valid() const { return patternLen > 0; }
+        int length() const { return patternLen; }
+        char const * folded() const { return patternLower; }
+        uint64_t mask() const { return patternMask; }
+
+      private:
+        template <typename Policy, typename IndexT> bool match_indexed(char const * str, int & outScore, IndexT * matches, int maxMatches) const;
+
+        char patternLower[257];     // folded pattern, null terminated
+        int patternLen;             // 0 if pattern is empty or too long
+        uint64_t patternMask;       // one bit per character class in pattern
+        bool stop[256];             // true for '\0' and both cases of first pattern character
+        uint64_t bitMasks[256];     // bit i set for bytes that fold to pattern character i, first 64 characters only
+    };
 }
 
 
@@ -50,20 +284,106 @@ namespace fts {
 
     // Forward declarations for "private" implementation
     namespace fuzzy_internal {
-        static bool fuzzy_match_recursive(const char * pattern, const char * str, int & outScore, const char * strBegin,          
-            uint8_t const * srcMatches,  uint8_t * newMatches,  int maxMatches, int nextMatch, 
-            int & recursionCount, int recursionLimit);
+        template <typename Policy, typename IndexT>
+        static bool fuzzy_match_folding(const char * pattern, const char * str, int & outScore, IndexT * matches, int maxMatches);
+        template <typename Policy, typename IndexT>
+        static bool fuzzy_match_length(const char * pattern, int patternLen, const char * str, int strLen, int & outScore, IndexT * matches, int maxMatches);
+        template <typename Policy, typename CharT, typename IndexT>
+        static bool fuzzy_match_indexed(const CharT * patternLower, int patternLen, const CharT * str, const CharT * strBegin, int strLen,
+            int & outScore, IndexT * matches, int maxMatches, int minScore);
+        template <typename Policy, typename CharT, typename IndexT>
+        static bool fuzzy_match_recursive(const CharT * pattern, const CharT * str, int & outScore, const CharT * strBegin,          
+            int strLen, int patternLen, IndexT * matches, IndexT * scratch, int nextMatch, int lastIdx,
+            int prefixScore, int minScore, int & recursionCount, int recursionLimit);
+        template <typename CharT>
+        static void skip_branches(const CharT * pattern, const CharT * str, const CharT * strEnd, int & recursionCount, int recursionLimit);
+        template <typename Policy, typename IndexT>
+        static bool fuzzy_match_dp(const char * patternLower, int patternLen, const char * str, int & outScore, IndexT * matches, int maxMatches, int minScore);
+        template <typename Policy, typename IndexT>
+        static bool fuzzy_match_optimal_folding(const char * pattern, const char * str, int & outScore, IndexT * matches, int maxMatches);
+        static void fuzzy_match_dp_lanes(const char * patternLower, int patternLen, const char * const * strs, int count, int * outScores);
+        template <typename Policy>
+        static int score_bound(int prefixScore, int matched, int patternLen, int strLen);
+        static bool fuzzy_match_utf8_decoded(const char * pattern, const char * str, int & outScore, uint32_t * matches, int maxMatches);
+        template <typename Policy, typename CharT>
+        static int position_bonus(const CharT * strBegin, int idx);
+        static int fold_pattern(const char * pattern, char * outFolded, int maxLen);
+        static int fold_pattern(const char * pattern, int patternLen, char * outFolded, int maxLen);
+        static int char_bit(char folded);
+        static const char * find_next(const char * str, char folded);
+        static const char * find_next(const char * str, const char * end, char folded);
+        static const char * find_non_ascii(const char * str);
+        static uint32_t decode_utf8(const char * & str);
+        static int decode_utf8_string(const char * str, uint32_t * outCodePoints, uint32_t * outOffsets);
+        static const char * skip_bom(const char * str);
+
+        // Case helpers shared by byte and code point scorers
+        static char fold_case(char c);
+        static uint32_t fold_case(uint32_t c);
+        static bool is_lower(char c);
+        static bool is_lower(uint32_t c);
+        static bool is_upper(char c);
+        static bool is_upper(uint32_t c);
+        static bool is_separator(char c);
+        static bool is_separator(uint32_t c);
+        static int count_trailing_zeros(uint32_t mask);
+        static int count_trailing_zeros(uint64_t mask);
+        static void positions_to_mask(uint32_t const * matches, int count, FuzzyMatchMask & outMask);
+
+        const int invalid_score = -0x3fffffff;      // dp cell that can not be reached. Safe to add bonuses to.
+
+        // Strings scored together by fuzzy_match_dp_lanes
+#if defined(FTS_FUZZY_MATCH_AVX2)
+        const int dp_lanes = 16;
+#elif defined(FTS_FUZZY_MATCH_SSE2)
+        const int dp_lanes = 8;
+#else
+        const int dp_lanes = 1;
+#endif
+
+        // Character classes stored in class_table
+        const uint8_t char_lower = 1;
+        const uint8_t char_upper = 2;
+        const uint8_t char_separator = 4;           // FuzzyDefaultScoring separators
+        const uint8_t char_digit = 8;
+
+        // Table entries. Same results as the "C" locale. Bytes above 0x7F are never letters.
+        constexpr char fold_entry(int c) {
+            return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : (char)c;
+        }
+
+        constexpr uint8_t class_entry(int c) {
+            return (uint8_t)((c >= 'a' && c <= 'z' ? char_lower : 0) | (c >= 'A' && c <= 'Z' ? char_upper : 0)
+                | (c == '_' || c == ' ' ? char_separator : 0) | (c >= '0' && c <= '9' ? char_digit : 0));
+        }
+
+        // Expands f(0) ... f(255). C++11 constexpr functions can't loop.
+#define FTS_FUZZY_TABLE_4(f, i)     f(i), f(i + 1), f(i + 2), f(i + 3)
+#define FTS_FUZZY_TABLE_16(f, i)    FTS_FUZZY_TABLE_4(f, i), FTS_FUZZY_TABLE_4(f, i + 4), FTS_FUZZY_TABLE_4(f, i + 8), FTS_FUZZY_TABLE_4(f, i + 12)
+#define FTS_FUZZY_TABLE_64(f, i)    FTS_FUZZY_TABLE_16(f, i), FTS_FUZZY_TABLE_16(f, i + 16), FTS_FUZZY_TABLE_16(f, i + 32), FTS_FUZZY_TABLE_16(f, i + 48)
+#define FTS_FUZZY_TABLE_256(f)      FTS_FUZZY_TABLE_64(f, 0), FTS_FUZZY_TABLE_64(f, 64), FTS_FUZZY_TABLE_64(f, 128), FTS_FUZZY_TABLE_64(f, 192)
+
+        // Indexed by (uint8_t)c. Used by every byte loop instead of <ctype.h> so results never depend on locale.
+        constexpr char fold_table[256] = { FTS_FUZZY_TABLE_256(fold_entry) };
+        constexpr uint8_t class_table[256] = { FTS_FUZZY_TABLE_256(class_entry) };
+
+#undef FTS_FUZZY_TABLE_4
+#undef FTS_FUZZY_TABLE_16
+#undef FTS_FUZZY_TABLE_64
+#undef FTS_FUZZY_TABLE_256
     }
 
     // Public interface
     static bool fuzzy_match_simple(char const * pattern, char const * str) {
-        while (*pattern != '\0' && *str != '\0')  {
-            if (tolower(*pattern) == tolower(*str))
-                ++pattern;
+        while (*pattern != '\0') {
+            str = fuzzy_internal::find_next(str, fuzzy_internal::fold_case(*pattern));
+            if (*str == '\0')
+                return false;
+            ++pattern;
             ++str;
         }
 
-        return *pattern == '\0' ? true : false;
+        return true;
     }
 
     static bool fuzzy_match(char const * pattern, char const * str, int & outScore) {
@@ -73,147 +393,1350 @@ namespace fts {
     }
 
     static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint8_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint16_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, FuzzyMatchMask & outMask) {
+        uint32_t matches[256];
+        if (!fuzzy_match(pattern, str, outScore, matches, 256))
+            return false;
+
+        fuzzy_internal::positions_to_mask(matches, (int)strlen(pattern), outMask);
+        return true;
+    }
+
+    static bool fuzzy_match_simple(char const * pattern, char const * str, int strLen) {
+        char const * end = str + strLen;
+        while (*pattern != '\0') {
+            str = fuzzy_internal::find_next(str, end, fuzzy_internal::fold_case(*pattern));
+            if (str == end)
+                return false;
+            ++pattern;
+            ++str;
+        }
+
+        return true;
+    }
+
+    static bool fuzzy_match(char const * pattern, char const * str, int strLen, int & outScore) {
+        uint8_t matches[256];
+        return fuzzy_internal::fuzzy_match_length<FuzzyDefaultScoring>(pattern, (int)strlen(pattern), str, strLen, outScore, matches, sizeof(matches));
+    }
+
+    static bool fuzzy_match(char const * pattern, char const * str, int strLen, int & outScore, uint32_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_length<FuzzyDefaultScoring>(pattern, (int)strlen(pattern), str, strLen, outScore, matches, maxMatches);
+    }
+
+#if defined(FTS_FUZZY_MATCH_STRING_VIEW)
+    static bool fuzzy_match_simple(std::string_view pattern, std::string_view str) {
+        char const * next = str.data();
+        char const * end = next + str.size();
+        for (char c : pattern) {
+            next = fuzzy_internal::find_next(next, end, fuzzy_internal::fold_case(c));
+            if (next == end)
+                return false;
+            ++next;
+        }
+
+        return true;
+    }
+
+    static bool fuzzy_match(std::string_view pattern, std::string_view str, int & outScore) {
+        uint8_t matches[256];
+        return fuzzy_internal::fuzzy_match_length<FuzzyDefaultScoring>(pattern.data(), (int)pattern.size(), str.data(), (int)str.size(), outScore, matches, sizeof(matches));
+    }
+
+    static bool fuzzy_match(std::string_view pattern, std::string_view str, int & outScore, uint32_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_length<FuzzyDefaultScoring>(pattern.data(), (int)pattern.size(), str.data(), (int)str.size(), outScore, matches, maxMatches);
+    }
+#endif
+
+    static bool fuzzy_match_simple_utf8(char const * pattern, char const * str) {
+        using namespace fuzzy_internal;
+
+        // Pure ASCII takes the byte path
+        if (*find_non_ascii(pattern) == '\0' && *find_non_ascii(str) == '\0')
+            return fuzzy_match_simple(pattern, str);
+
+        pattern = skip_bom(pattern);
+        str = skip_bom(str);
+        while (*pattern != '\0') {
+            uint32_t folded = fold_case(decode_utf8(pattern));
+            for (;;) {
+                if (*str == '\0')
+                    return false;
+                if (fold_case(decode_utf8(str)) == folded)
+                    break;
+            }
+        }
+
+        return true;
+    }
+
+    static bool fuzzy_match_utf8(char const * pattern, char const * str, int & outScore) {
+        using namespace fuzzy_internal;
+
+        // Pure ASCII takes the byte path
+        if (*find_non_ascii(pattern) == '\0' && *find_non_ascii(str) == '\0')
+            return fuzzy_match(pattern, str, outScore);
+
+        uint32_t matches[256];
+        return fuzzy_match_utf8_decoded(pattern, str, outScore, matches, 256);
+    }
+
+    static bool fuzzy_match_utf8(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches) {
+        using namespace fuzzy_internal;
+
+        // Pure ASCII takes the byte path. Byte offsets and character indices are the same.
+        if (*find_non_ascii(pattern) == '\0' && *find_non_ascii(str) == '\0')
+            return fuzzy_match(pattern, str, outScore, matches, maxMatches);
+
+        return fuzzy_match_utf8_decoded(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<FuzzyDefaultScoring, uint8_t>(pattern, str, outScore, nullptr, 256);
+    }
+
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint8_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint16_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, uint32_t * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<FuzzyDefaultScoring>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, FuzzyMatchMask & outMask) {
+        uint32_t matches[256];
+        if (!fuzzy_match_optimal(pattern, str, outScore, matches, 256))
+            return false;
+
+        fuzzy_internal::positions_to_mask(matches, (int)strlen(pattern), outMask);
+        return true;
+    }
+
+    static int fuzzy_match_batch(char const * pattern, char const * const * candidates, int count, int * outScores) {
+        // Compile pattern once
+        FuzzyPattern compiled(pattern);
+
+        int matched = 0;
+        for (int i = 0; i < count; ++i) {
+            int score;
+            if (compiled.match(candidates[i], score)) {
+                outScores[i] = score;
+                ++matched;
+            }
+            else {
+                outScores[i] = fuzzy_no_match;
+            }
+        }
+
+        return matched;
+    }
+
+    static int fuzzy_match_batch(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int * outScores) {
+        // Compile pattern once
+        FuzzyPattern compiled(pattern);
+
+        int matched = 0;
+        for (int i = 0; i < count; ++i) {
+            int score;
+            if (compiled.might_match(signatures[i]) && compiled.match(candidates[i], score)) {
+                outScores[i] = score;
+                ++matched;
+            }
+            else {
+                outScores[i] = fuzzy_no_match;
+            }
+        }
+
+        return matched;
+    }
+
+    static int fuzzy_match_optimal_batch(char const * pattern, char const * const * candidates, int count, int * outScores) {
+        FuzzyPattern compiled(pattern);
+
+        // Strings that pass the subsequence test wait here until a full group of lanes is ready
+        const char * queued[fuzzy_internal::dp_lanes];
+        int queuedIndex[fuzzy_internal::dp_lanes];
+        int laneScores[fuzzy_internal::dp_lanes];
+        int pending = 0;
+
+        int matched = 0;
+        for (int i = 0; i <= count; ++i) {
+            if (i < count) {
+                outScores[i] = fuzzy_no_match;
+                if (!compiled.match(candidates[i]))
+                    continue;
+                queued[pending] = candidates[i];
+                queuedIndex[pending] = i;
+                ++pending;
+            }
+
+            // Flush a full group, or whatever is left after the last string
+            if (pending == fuzzy_internal::dp_lanes || (i == count && pending > 0)) {
+                fuzzy_internal::fuzzy_match_dp_lanes(compiled.folded(), compiled.length(), queued, pending, laneScores);
+                for (int lane = 0; lane < pending; ++lane) {
+                    outScores[queuedIndex[lane]] = laneScores[lane];
+                    if (laneScores[lane] != fuzzy_no_match)
+                        ++matched;
+                }
+                pending = 0;
+            }
+        }
+
+        return matched;
+    }
+
+    static uint64_t fuzzy_signature(char const * str) {
+        uint64_t signature = 0;
+        while (*str != '\0') {
+            signature |= uint64_t(1) << fuzzy_internal::char_bit(fuzzy_internal::fold_case(*str));
+            ++str;
+        }
+        return signature;
+    }
+
+    static int fuzzy_score_upper_bound(int patternLen, int strLen) {
+        return fuzzy_score_upper_bound<FuzzyDefaultScoring>(patternLen, strLen);
+    }
+
+    template <typename Policy>
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore) {
+        uint8_t matches[256];
+        return fuzzy_internal::fuzzy_match_folding<Policy>(pattern, str, outScore, matches, sizeof(matches));
+    }
+
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_match(char const * pattern, char const * str, int & outScore, IndexT * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_folding<Policy>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    template <typename Policy>
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<Policy, uint8_t>(pattern, str, outScore, nullptr, 256);
+    }
+
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_match_optimal(char const * pattern, char const * str, int & outScore, IndexT * matches, int maxMatches) {
+        return fuzzy_internal::fuzzy_match_optimal_folding<Policy>(pattern, str, outScore, matches, maxMatches);
+    }
+
+    template <typename Policy>
+    static int fuzzy_score_upper_bound(int patternLen, int strLen) {
+        // Camel and separator bonuses are exclusive. Neighbor can't be both lower case and a separator.
+        int camel = Policy::camel_bonus;
+        int separator = Policy::separator_bonus;
+        int bestPositionBonus = camel > separator ? camel : separator;
+
+        // First match is either the first letter or follows at least one leading letter
+        int leadingPenalty = Policy::leading_letter_penalty;
+        if (leadingPenalty < Policy::max_leading_letter_penalty)
+            leadingPenalty = Policy::max_leading_letter_penalty;
+        int firstBonus = Policy::first_letter_bonus;
+        if (leadingPenalty + bestPositionBonus > firstBonus)
+            firstBonus = leadingPenalty + bestPositionBonus;
+
+        return 100 + firstBonus + (patternLen - 1) * (Policy::sequential_bonus + bestPositionBonus) + Policy::unmatched_letter_penalty * (strLen - patternLen);
+    }
+
+    // FuzzyDefaultScoring
+    bool FuzzyDefaultScoring::is_separator(char c) {
+        return fuzzy_internal::is_separator(c);
+    }
+
+    bool FuzzyDefaultScoring::is_separator(uint32_t c) {
+        return fuzzy_internal::is_separator(c);
+    }
+
+    // FuzzyPattern
+    FuzzyPattern::FuzzyPattern(char const * pattern) {
+        patternLen = fuzzy_internal::fold_pattern(pattern, patternLower, 256);
+        if (patternLen < 0) {
+            patternLen = 0;
+            patternLower[0] = '\0';
+        }
+
+        patternMask = 0;
+        for (int i = 0; i < patternLen; ++i)
+            patternMask |= uint64_t(1) << fuzzy_internal::char_bit(patternLower[i]);
+
+        // Every byte that folds to the first pattern character
+        memset(stop, 0, sizeof(stop));
+        stop[0] = true;
+        for (int c = 1; c < 256; ++c)
+            if (fuzzy_internal::fold_table[c] == patternLower[0])
+                stop[c] = true;
+
+        // Shift-And masks. Built per folded character then spread to every byte that folds to it.
+        // '\0' keeps a zero mask so it never advances the state.
+        uint64_t foldedMasks[256] = {};
+        for (int i = 0; i < patternLen && i < 64; ++i)
+            foldedMasks[(uint8_t)patternLower[i]] |= uint64_t(1) << i;
+        bitMasks[0] = 0;
+        for (int c = 1; c < 256; ++c)
+            bitMasks[c] = foldedMasks[(uint8_t)fuzzy_internal::fold_table[c]];
+    }
+
+    bool FuzzyPattern::match(char const * str) const {
+        if (!valid())
+            return false;
+
+#if !defined(FTS_FUZZY_MATCH_AVX2) && !defined(FTS_FUZZY_MATCH_SSE2)
+        if (patternLen <= 64)
+            return match_bit_parallel(str);
+#endif
+
+        char const * pattern = patternLower;
+        while (*pattern != '\0') {
+            str = fuzzy_internal::find_next(str, *pattern);
+            if (*str == '\0')
+                return false;
+            ++pattern;
+            ++str;
+        }
+
+        return true;
+    }
+
+    bool FuzzyPattern::match_bit_parallel(char const * str) const {
+        if (!valid())
+            return false;
+        if (patternLen > 64)
+            return match(str);
+
+        // Masks use the state from before this byte, so one byte never advances two pattern characters
+        const uint64_t done = uint64_t(1) << (patternLen - 1);
+        uint64_t state = 0;
+        for (; *str != '\0'; ++str)
+            state |= ((state << 1) | 1) & bitMasks[(uint8_t)*str];
+        return (state & done) != 0;
+    }
+
+    bool FuzzyPattern::match_bit_parallel(char const * str, int strLen) const {
+        if (!valid())
+            return false;
+        if (patternLen > 64)
+            return fuzzy_match_simple(patternLower, str, strLen);
+
+        const uint64_t done = uint64_t(1) << (patternLen - 1);
+        uint64_t state = 0;
+        for (int i = 0; i < strLen; ++i)
+            state |= ((state << 1) | 1) & bitMasks[(uint8_t)str[i]];
+        return (state & done) != 0;
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore) const {
+        uint8_t matches[256];
+        return match(str, outScore, matches, sizeof(matches));
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore, uint8_t * matches, int maxMatches) const {
+        return match_indexed<FuzzyDefaultScoring>(str, outScore, matches, maxMatches);
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore, uint16_t * matches, int maxMatches) const {
+        return match_indexed<FuzzyDefaultScoring>(str, outScore, matches, maxMatches);
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore, uint32_t * matches, int maxMatches) const {
+        return match_indexed<FuzzyDefaultScoring>(str, outScore, matches, maxMatches);
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore, FuzzyMatchMask & outMask) const {
+        uint32_t matches[256];
+        if (!match(str, outScore, matches, 256))
+            return false;
+
+        fuzzy_internal::positions_to_mask(matches, patternLen, outMask);
+        return true;
+    }
+
+    template <typename Policy>
+    bool FuzzyPattern::match(char const * str, int & outScore) const {
+        uint8_t matches[256];
+        return match_indexed<Policy>(str, outScore, matches, sizeof(matches));
+    }
+
+    template <typename Policy>
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore) const {
+        return fuzzy_internal::fuzzy_match_dp<Policy, uint8_t>(patternLower, patternLen, str, outScore, nullptr, 256, fuzzy_no_match);
+    }
+
+    template <typename Policy, typename IndexT>
+    bool FuzzyPattern::match_indexed(char const * str, int & outScore, IndexT * matches, int maxMatches) const {
+        if (!valid())
+            return false;
+
+        // Skip to first possible match
+        char const * first = str;
+        while (!stop[(uint8_t)*first])
+            ++first;
+        if (*first == '\0')
+            return false;
+
+        int strLen = (int)(first - str) + (int)strlen(first);
+        return fuzzy_internal::fuzzy_match_indexed<Policy>(patternLower, patternLen, first, str, strLen, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    bool FuzzyPattern::match(char const * str, int & outScore, int minScore) const {
+        if (!valid())
+            return false;
+
+        // Reject on length alone before scanning
+        int strLen = (int)strlen(str);
+        if (fuzzy_score_upper_bound(patternLen, strLen) < minScore)
+            return false;
+
+        // Skip to first possible match
+        char const * first = str;
+        while (!stop[(uint8_t)*first])
+            ++first;
+        if (*first == '\0')
+            return false;
+
+        uint8_t matches[256];
+        return fuzzy_internal::fuzzy_match_indexed<FuzzyDefaultScoring>(patternLower, patternLen, first, str, strLen, outScore, matches, sizeof(matches), minScore);
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore) const {
+        return fuzzy_internal::fuzzy_match_dp<FuzzyDefaultScoring, uint8_t>(patternLower, patternLen, str, outScore, nullptr, 256, fuzzy_no_match);
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore, uint8_t * matches, int maxMatches) const {
+        return fuzzy_internal::fuzzy_match_dp<FuzzyDefaultScoring>(patternLower, patternLen, str, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore, uint16_t * matches, int maxMatches) const {
+        return fuzzy_internal::fuzzy_match_dp<FuzzyDefaultScoring>(patternLower, patternLen, str, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore, uint32_t * matches, int maxMatches) const {
+        return fuzzy_internal::fuzzy_match_dp<FuzzyDefaultScoring>(patternLower, patternLen, str, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore, FuzzyMatchMask & outMask) const {
+        uint32_t matches[256];
+        if (!match_optimal(str, outScore, matches, 256))
+            return false;
+
+        fuzzy_internal::positions_to_mask(matches, patternLen, outMask);
+        return true;
+    }
+
+    bool FuzzyPattern::match_optimal(char const * str, int & outScore, int minScore) const {
+        return fuzzy_internal::fuzzy_match_dp<FuzzyDefaultScoring, uint8_t>(patternLower, patternLen, str, outScore, nullptr, 256, minScore);
+    }
+
+    // Private implementation
+    static int fuzzy_internal::fold_pattern(const char * pattern, char * outFolded, int maxLen) {
+        int len = 0;
+        while (pattern[len] != '\0') {
+            if (len >= maxLen)
+                return -1;
+            outFolded[len] = fold_case(pattern[len]);
+            ++len;
+        }
+        outFolded[len] = '\0';
+        return len;
+    }
+
+    // Pattern with a length. A '\0' inside it would end the folded pattern early so it's rejected.
+    static int fuzzy_internal::fold_pattern(const char * pattern, int patternLen, char * outFolded, int maxLen) {
+        if (patternLen > maxLen)
+            return -1;
+
+        for (int i = 0; i < patternLen; ++i) {
+            if (pattern[i] == '\0')
+                return -1;
+            outFolded[i] = fold_case(pattern[i]);
+        }
+        outFolded[patternLen] = '\0';
+        return patternLen;
+    }
+
+    // Bit index used for pattern and string masks. Letters and digits get their own bit.
+    // Common separators get their own bit. Everything else shares the remaining bits.
+    static int fuzzy_internal::char_bit(char folded) {
+        uint8_t c = (uint8_t)folded;
+        if (class_table[c] & char_lower)
+            return c - 'a';
+        if (class_table[c] & char_digit)
+            return 26 + (c - '0');
+        switch (c) {
+            case '_':  return 36;
+            case ' ':  return 37;
+            case '/':  return 38;
+            case '\\': return 39;
+            case '.':  return 40;
+            case '-':  return 41;
+        }
+        if (c >= 0x80)
+            return 63;
+        return 42 + c % 21;
+    }
+
+    // Returns first character in str that folds to folded, or the terminating '\0'.
+    // SIMD versions fold case by setting 0x20 on every byte. That is exact when folded is a letter.
+    // For anything else bytes are compared as-is. Unbounded versions read past '\0' to the end of its aligned block,
+    // and the first block may start before str. That is deliberate. Aligned loads never cross a page so the extra bytes
+    // are always readable, and bits for them are masked off.
+#if defined(FTS_FUZZY_MATCH_AVX2)
+    FTS_FUZZY_MATCH_NO_ASAN
+    static const char * fuzzy_internal::find_next(const char * str, char folded) {
+        const __m256i caseBit = _mm256_set1_epi8(folded >= 'a' && folded <= 'z' ? 0x20 : 0);
+        const __m256i target = _mm256_set1_epi8(folded);
+        const __m256i zero = _mm256_setzero_si256();
+
+        uintptr_t offset = (uintptr_t)str & 31;
+        const char * block = str - offset;
+        __m256i chunk = _mm256_load_si256((const __m256i*)block);
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(chunk, caseBit), target), _mm256_cmpeq_epi8(chunk, zero));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits) & (0xFFFFFFFFu << offset);
+
+        while (mask == 0) {
+            block += 32;
+            chunk = _mm256_load_si256((const __m256i*)block);
+            hits = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(chunk, caseBit), target), _mm256_cmpeq_epi8(chunk, zero));
+            mask = (uint32_t)_mm256_movemask_epi8(hits);
+        }
+
+        return block + count_trailing_zeros(mask);
+    }
+
+    // Bounded version returns end if nothing in [str, end) folds to folded. Unaligned loads stop short of end.
+    static const char * fuzzy_internal::find_next(const char * str, const char * end, char folded) {
+        const __m256i caseBit = _mm256_set1_epi8(folded >= 'a' && folded <= 'z' ? 0x20 : 0);
+        const __m256i target = _mm256_set1_epi8(folded);
+
+        while (end - str >= 32) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i*)str);
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_or_si256(chunk, caseBit), target));
+            if (mask != 0)
+                return str + count_trailing_zeros(mask);
+            str += 32;
+        }
+
+        while (str != end && fold_case(*str) != folded)
+            ++str;
+        return str;
+    }
+
+    FTS_FUZZY_MATCH_NO_ASAN
+    static const char * fuzzy_internal::find_non_ascii(const char * str) {
+        const __m256i zero = _mm256_setzero_si256();
+
+        uintptr_t offset = (uintptr_t)str & 31;
+        const char * block = str - offset;
+        __m256i chunk = _mm256_load_si256((const __m256i*)block);
+        uint32_t mask = ((uint32_t)_mm256_movemask_epi8(chunk) | (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero))) & (0xFFFFFFFFu << offset);
+
+        while (mask == 0) {
+            block += 32;
+            chunk = _mm256_load_si256((const __m256i*)block);
+            mask = (uint32_t)_mm256_movemask_epi8(chunk) | (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero));
+        }
+
+        return block + count_trailing_zeros(mask);
+    }
+#elif defined(FTS_FUZZY_MATCH_SSE2)
+    FTS_FUZZY_MATCH_NO_ASAN
+    static const char * fuzzy_internal::find_next(const char * str, char folded) {
+        const __m128i caseBit = _mm_set1_epi8(folded >= 'a' && folded <= 'z' ? 0x20 : 0);
+        const __m128i target = _mm_set1_epi8(folded);
+        const __m128i zero = _mm_setzero_si128();
+
+        uintptr_t offset = (uintptr_t)str & 15;
+        const char * block = str - offset;
+        __m128i chunk = _mm_load_si128((const __m128i*)block);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(chunk, caseBit), target), _mm_cmpeq_epi8(chunk, zero));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(hits) & (0xFFFFu << offset);
+
+        while (mask == 0) {
+            block += 16;
+            chunk = _mm_load_si128((const __m128i*)block);
+            hits = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(chunk, caseBit), target), _mm_cmpeq_epi8(chunk, zero));
+            mask = (uint32_t)_mm_movemask_epi8(hits);
+        }
+
+        return block + count_trailing_zeros(mask);
+    }
+
+    // Bounded version returns end if nothing in [str, end) folds to folded. Unaligned loads stop short of end.
+    static const char * fuzzy_internal::find_next(const char * str, const char * end, char folded) {
+        const __m128i caseBit = _mm_set1_epi8(folded >= 'a' && folded <= 'z' ? 0x20 : 0);
+        const __m128i target = _mm_set1_epi8(folded);
+
+        while (end - str >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)str);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(chunk, caseBit), target));
+            if (mask != 0)
+                return str + count_trailing_zeros(mask);
+            str += 16;
+        }
+
+        while (str != end && fold_case(*str) != folded)
+            ++str;
+        return str;
+    }
+
+    FTS_FUZZY_MATCH_NO_ASAN
+    static const char * fuzzy_internal::find_non_ascii(const char * str) {
+        const __m128i zero = _mm_setzero_si128();
+
+        uintptr_t offset = (uintptr_t)str & 15;
+        const char * block = str - offset;
+        __m128i chunk = _mm_load_si128((const __m128i*)block);
+        uint32_t mask = ((uint32_t)_mm_movemask_epi8(chunk) | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero))) & (0xFFFFu << offset);
+
+        while (mask == 0) {
+            block += 16;
+            chunk = _mm_load_si128((const __m128i*)block);
+            mask = (uint32_t)_mm_movemask_epi8(chunk) | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+        }
+
+        return block + count_trailing_zeros(mask);
+    }
+#else
+    static const char * fuzzy_internal::find_next(const char * str, char folded) {
+        while (*str != '\0' && fold_case(*str) != folded)
+            ++str;
+        return str;
+    }
+
+    static const char * fuzzy_internal::find_next(const char * str, const char * end, char folded) {
+        while (str != end && fold_case(*str) != folded)
+            ++str;
+        return str;
+    }
+
+    static const char * fuzzy_internal::find_non_ascii(const char * str) {
+        while (*str != '\0' && (uint8_t)*str < 0x80)
+            ++str;
+        return str;
+    }
+#endif
+
+    // Decodes one code point and advances str past it. Invalid or truncated sequences decode as a single byte.
+    static uint32_t fuzzy_internal::decode_utf8(const char * & str) {
+        const uint8_t * bytes = (const uint8_t *)str;
+        uint32_t c = bytes[0];
+        uint32_t minimum = 0;
+        int length = 1;
+        if (c >= 0xC2 && c <= 0xDF) {
+            c &= 0x1F;
+            minimum = 0x80;
+            length = 2;
+        }
+        else if (c >= 0xE0 && c <= 0xEF) {
+            c &= 0x0F;
+            minimum = 0x800;
+            length = 3;
+        }
+        else if (c >= 0xF0 && c <= 0xF4) {
+            c &= 0x07;
+            minimum = 0x10000;
+            length = 4;
+        }
+
+        // Continuation bytes. Stops at '\0' since it isn't one.
+        for (int i = 1; i < length; ++i) {
+            if ((bytes[i] & 0xC0) != 0x80) {
+                ++str;
+                return bytes[0];
+            }
+            c = (c << 6) | (bytes[i] & 0x3F);
+        }
+
+        // Overlong, surrogate, or out of range
+        if (c < minimum || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+            ++str;
+            return bytes[0];
+        }
+
+        str += length;
+        return c;
+    }
+
+    // Decodes str into null terminated outCodePoints. outOffsets receives the byte offset of each code point.
+    // Both buffers need room for strlen(str) + 1 entries. Returns number of code points.
+    static int fuzzy_internal::decode_utf8_string(const char * str, uint32_t * outCodePoints, uint32_t * outOffsets) {
+        const char * begin = str;
+
+        str = skip_bom(str);
+
+        int count = 0;
+        while (*str != '\0') {
+            outOffsets[count] = (uint32_t)(str - begin);
+            outCodePoints[count++] = decode_utf8(str);
+        }
+        outCodePoints[count] = 0;
+        return count;
+    }
+
+    // Byte order mark isn't part of the text
+    static const char * fuzzy_internal::skip_bom(const char * str) {
+        if ((uint8_t)str[0] == 0xEF && (uint8_t)str[1] == 0xBB && (uint8_t)str[2] == 0xBF)
+            return str + 3;
+        return str;
+    }
+
+    static char fuzzy_internal::fold_case(char c) {
+        return fold_table[(uint8_t)c];
+    }
+
+    // Simple one to one case folding for Latin-1, Latin Extended-A, Greek, and Cyrillic
+    static uint32_t fuzzy_internal::fold_case(uint32_t c) {
+        if (c < 0x80)
+            return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+
+        // Latin-1 Supplement
+        if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+            return c + 0x20;
+
+        // Latin Extended-A. Mostly upper then lower pairs.
+        if (c >= 0x100 && c <= 0x17F) {
+            if (c == 0x130)
+                return 'i';
+            if (c == 0x178)
+                return 0xFF;
+            if (c == 0x131 || c == 0x138 || c == 0x149 || c == 0x17F)
+                return c;
+            if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+                return (c & 1) ? c + 1 : c;
+            return (c & 1) ? c : c + 1;
+        }
+
+        // Greek
+        if (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+            return c + 0x20;
+        if (c == 0x386)
+            return 0x3AC;
+        if (c >= 0x388 && c <= 0x38A)
+            return c + 0x25;
+        if (c == 0x38C)
+            return 0x3CC;
+        if (c == 0x38E || c == 0x38F)
+            return c + 0x3F;
+        if (c == 0x3C2)
+            return 0x3C3;   // final sigma
+
+        // Cyrillic
+        if (c >= 0x410 && c <= 0x42F)
+            return c + 0x20;
+        if (c >= 0x400 && c <= 0x40F)
+            return c + 0x50;
+
+        return c;
+    }
+
+    static bool fuzzy_internal::is_lower(char c) {
+        return (class_table[(uint8_t)c] & char_lower) != 0;
+    }
+
+    static bool fuzzy_internal::is_lower(uint32_t c) {
+        if (c < 0x80)
+            return c >= 'a' && c <= 'z';
+        if (c >= 0xDF && c <= 0xFF)
+            return c != 0xF7;
+        if (c >= 0x100 && c <= 0x17F)
+            return fold_case(c) == c;
+        return (c >= 0x3AC && c <= 0x3CE) || (c >= 0x430 && c <= 0x45F);
+    }
+
+    static bool fuzzy_internal::is_upper(char c) {
+        return (class_table[(uint8_t)c] & char_upper) != 0;
+    }
+
+    // Final sigma folds to sigma but is already lower case
+    static bool fuzzy_internal::is_upper(uint32_t c) {
+        return c != 0x3C2 && fold_case(c) != c;
+    }
+
+    static bool fuzzy_internal::is_separator(char c) {
+        return (class_table[(uint8_t)c] & char_separator) != 0;
+    }
+
+    static bool fuzzy_internal::is_separator(uint32_t c) {
+        return c == '_' || c == ' ';
+    }
+
+    static bool fuzzy_internal::fuzzy_match_utf8_decoded(const char * pattern, const char * str, int & outScore, uint32_t * matches, int maxMatches) {
+        // Decode and fold pattern
+        uint32_t patternLower[257];
+        int patternLen = 0;
+        pattern = skip_bom(pattern);
+        while (*pattern != '\0') {
+            if (patternLen >= 256)
+                return false;
+            patternLower[patternLen++] = fold_case(decode_utf8(pattern));
+        }
+        patternLower[patternLen] = 0;
+
+        // Decode str. Never more code points than bytes. Short strings stay on the stack.
+        uint32_t stackBuffer[2 * 256];
+        size_t entries = strlen(str) + 1;
+        uint32_t * codePoints = entries <= 256 ? stackBuffer : (uint32_t*)malloc(2 * entries * sizeof(uint32_t));
+        if (!codePoints)
+            return false;
+        uint32_t * offsets = codePoints + entries;
+
+        int strLen = decode_utf8_string(str, codePoints, offsets);
+        bool matched = fuzzy_match_indexed<FuzzyDefaultScoring>(patternLower, patternLen, codePoints, codePoints, strLen, outScore, matches, maxMatches, fuzzy_no_match);
+
+        // Convert code point indices to byte offsets
+        if (matched) {
+            for (int i = 0; i < patternLen; ++i)
+                matches[i] = offsets[matches[i]];
+        }
+
+        if (codePoints != stackBuffer)
+            free(codePoints);
+        return matched;
+    }
+
+    // mask must not be zero
+    static int fuzzy_internal::count_trailing_zeros(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (int)index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    static void fuzzy_internal::positions_to_mask(uint32_t const * matches, int count, FuzzyMatchMask & outMask) {
+        outMask.bits[0] = 0;
+        outMask.bits[1] = 0;
+        for (int i = 0; i < count; ++i)
+            if (matches[i] < 128)
+                outMask.bits[matches[i] >> 6] |= uint64_t(1) << (matches[i] & 63);
+    }
+
+    // mask must not be zero. Split in halves so 32-bit targets don't need a 64-bit intrinsic.
+    static int fuzzy_internal::count_trailing_zeros(uint64_t mask) {
+        uint32_t low = (uint32_t)mask;
+        return low ? count_trailing_zeros(low) : 32 + count_trailing_zeros((uint32_t)(mask >> 32));
+    }
+
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_folding(const char * pattern, const char * str, int & outScore, IndexT * matches, int maxMatches) {
+        char patternLower[257];
+        int patternLen = fold_pattern(pattern, patternLower, 256);
+        if (patternLen < 0)
+            return false;
+
+        int strLen = (int)strlen(str);
+        return fuzzy_match_indexed<Policy>(patternLower, patternLen, str, str, strLen, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_length(const char * pattern, int patternLen, const char * str, int strLen, int & outScore, IndexT * matches, int maxMatches) {
+        char patternLower[257];
+        if (fold_pattern(pattern, patternLen, patternLower, 256) < 0)
+            return false;
+
+        return fuzzy_match_indexed<Policy>(patternLower, patternLen, str, str, strLen, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_optimal_folding(const char * pattern, const char * str, int & outScore, IndexT * matches, int maxMatches) {
+        char patternLower[257];
+        int patternLen = fold_pattern(pattern, patternLower, 256);
+        return fuzzy_match_dp<Policy>(patternLower, patternLen, str, outScore, matches, maxMatches, fuzzy_no_match);
+    }
+
+    // Entry point for the recursive scorer. Sets up the scratch arena used by recursion frames.
+    template <typename Policy, typename CharT, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_indexed(const CharT * patternLower, int patternLen, const CharT * str, const CharT * strBegin, int strLen,
+        int & outScore, IndexT * matches, int maxMatches, int minScore)
+    {
+        // Supplied matches buffer is too short for a full match
+        if (patternLen > maxMatches)
+            return false;
+
         int recursionCount = 0;
         int recursionLimit = 10;
 
-        return fuzzy_internal::fuzzy_match_recursive(pattern, str, outScore, str, nullptr, matches, maxMatches, 0, recursionCount, recursionLimit);
+        // Every recursion level needs two slots of patternLen indices. Short patterns fit on the stack.
+        IndexT stackScratch[2 * 10 * 16];
+        size_t scratchSize = (size_t)2 * recursionLimit * patternLen;
+        IndexT * scratch = scratchSize <= sizeof(stackScratch) / sizeof(stackScratch[0]) ? stackScratch : (IndexT*)malloc(scratchSize * sizeof(IndexT));
+        if (!scratch)
+            return false;
+
+        bool matched = fuzzy_match_recursive<Policy>(patternLower, str, outScore, strBegin, strLen, patternLen, matches, scratch, 0, -1, 0, minScore, recursionCount, recursionLimit);
+        if (matched && outScore < minScore)
+            matched = false;
+
+        if (scratch != stackScratch)
+            free(scratch);
+        return matched;
     }
 
-    // Private implementation
-    static bool fuzzy_internal::fuzzy_match_recursive(const char * pattern, const char * str, int & outScore, 
-        const char * strBegin, uint8_t const * srcMatches, uint8_t * matches, int maxMatches, 
-        int nextMatch, int & recursionCount, int recursionLimit)
+    // Upper bound for a match that has fixed its first matched characters with a score of prefixScore
+    template <typename Policy>
+    static int fuzzy_internal::score_bound(int prefixScore, int matched, int patternLen, int strLen) {
+        if (matched == 0)
+            return fuzzy_score_upper_bound<Policy>(patternLen, strLen);
+
+        int camel = Policy::camel_bonus;
+        int separator = Policy::separator_bonus;
+        int bestPositionBonus = camel > separator ? camel : separator;
+        return prefixScore + (patternLen - matched) * (Policy::sequential_bonus + bestPositionBonus) + Policy::unmatched_letter_penalty * (strLen - patternLen);
+    }
+
+    // pattern must already be folded to lower case. CharT is char for bytes or uint32_t for decoded code points.
+    // prefixScore is the score of the first nextMatch matches, excluding unmatched letters. It is built up as matches
+    // are found. Each match can only lower the upper bound, so once it drops below minScore the rest of this frame
+    // and every branch it would spawn are skipped.
+    // lastIdx is the str index of match nextMatch - 1. A frame only writes matches[nextMatch] onwards. Entries before
+    // that belong to its caller and are never copied.
+    // scratch holds two slots of patternLen indices for this frame followed by the slots of deeper frames.
+    template <typename Policy, typename CharT, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_recursive(const CharT * pattern, const CharT * str, int & outScore, 
+        const CharT * strBegin, int strLen, int patternLen, IndexT * matches, IndexT * scratch, 
+        int nextMatch, int lastIdx, int prefixScore, int minScore, int & recursionCount, int recursionLimit)
     {
         // Count recursions
         ++recursionCount;
         if (recursionCount >= recursionLimit)
             return false;
+        bool outermost = recursionCount == 1;
 
-        // Detect end of strings
-        if (*pattern == '\0' || *str == '\0')
+        // Detect end of strings. str may not be null terminated so its end comes from strLen.
+        const CharT * strEnd = strBegin + strLen;
+        if (*pattern == '\0' || str == strEnd)
             return false;
 
-        // Recursion params
+        // Skip branches that can't reach minScore. The branches they would spawn still use up recursions.
+        if (score_bound<Policy>(prefixScore, nextMatch, patternLen, strLen) < minScore) {
+            if (!outermost)
+                skip_branches(pattern, str, strEnd, recursionCount, recursionLimit);
+            return false;
+        }
+
+        // Recursion params. Slots are swapped rather than copied when a better recursive match is found.
         bool recursiveMatch = false;
-        uint8_t bestRecursiveMatches[256];
+        IndexT * recursiveMatches = scratch;
+        IndexT * bestRecursiveMatches = scratch + patternLen;
+        IndexT * deeperScratch = scratch + 2 * patternLen;
         int bestRecursiveScore = 0;
+        int bestRecursiveStart = 0;
 
         // Loop through pattern and str looking for a match
-        bool first_match = true;
-        while (*pattern != '\0' && *str != '\0') {
+        bool pruned = false;
+        while (*pattern != '\0' && str != strEnd) {
             
             // Found match
-            if (tolower(*pattern) == tolower(*str)) {
-
-                // Supplied matches buffer was too short
-                if (nextMatch >= maxMatches)
-                    return false;
-                
-                // "Copy-on-Write" srcMatches into matches
-                if (first_match && srcMatches) {
-                    memcpy(matches, srcMatches, nextMatch);
-                    first_match = false;
-                }
+            if (*pattern == fold_case(*str)) {
 
                 // Recursive call that "skips" this match
-                uint8_t recursiveMatches[256];
                 int recursiveScore;
-                if (fuzzy_match_recursive(pattern, str + 1, recursiveScore, strBegin, matches, recursiveMatches, sizeof(recursiveMatches), nextMatch, recursionCount, recursionLimit)) {
+                if (fuzzy_match_recursive<Policy>(pattern, str + 1, recursiveScore, strBegin, strLen, patternLen, recursiveMatches, deeperScratch, 
+                    nextMatch, lastIdx, prefixScore, minScore, recursionCount, recursionLimit)) {
                     
                     // Pick best recursive score
                     if (!recursiveMatch || recursiveScore > bestRecursiveScore) {
-                        memcpy(bestRecursiveMatches, recursiveMatches, 256);
+                        IndexT * swap = bestRecursiveMatches;
+                        bestRecursiveMatches = recursiveMatches;
+                        recursiveMatches = swap;
                         bestRecursiveScore = recursiveScore;
+                        bestRecursiveStart = nextMatch;
                     }
                     recursiveMatch = true;
                 }
 
+                // Score this match
+                int currIdx = (int)(str - strBegin);
+                if (nextMatch == 0) {
+                    // Initialize score and apply leading letter penalty
+                    int penalty = Policy::leading_letter_penalty * currIdx;
+                    if (penalty < Policy::max_leading_letter_penalty)
+                        penalty = Policy::max_leading_letter_penalty;
+                    prefixScore = 100 + penalty;
+                }
+                else if (currIdx == lastIdx + 1) {
+                    // Sequential
+                    prefixScore += Policy::sequential_bonus;
+                }
+                prefixScore += position_bonus<Policy>(strBegin, currIdx);
+
                 // Advance
-                matches[nextMatch++] = (uint8_t)(str - strBegin);
+                matches[nextMatch++] = (IndexT)currIdx;
+                lastIdx = currIdx;
                 ++pattern;
+
+                // Give up on this frame once it can't reach minScore. Every branch it would still spawn starts from
+                // this prefix so none of them can reach it either. Nothing runs after the outermost frame, otherwise
+                // those branches must use up the recursions they would have used without minScore.
+                if (score_bound<Policy>(prefixScore, nextMatch, patternLen, strLen) < minScore) {
+                    if (!outermost)
+                        skip_branches(pattern, str + 1, strEnd, recursionCount, recursionLimit);
+                    pruned = true;
+                    break;
+                }
             }
             ++str;
         }
 
         // Determine if full pattern was matched
-        bool matched = *pattern == '\0' ? true : false;
+        bool matched = !pruned && *pattern == '\0' ? true : false;
 
-        // Calculate score
-        if (matched) {
-            const int sequential_bonus = 15;            // bonus for adjacent matches
-            const int separator_bonus = 30;             // bonus if match occurs after a separator
-            const int camel_bonus = 30;                 // bonus if match is uppercase and prev is lower
-            const int first_letter_bonus = 15;          // bonus if the first letter is matched
+        // Apply unmatched penalty
+        if (matched)
+            outScore = prefixScore + Policy::unmatched_letter_penalty * (strLen - nextMatch);
 
-            const int leading_letter_penalty = -5;      // penalty applied for every letter in str before the first match
-            const int max_leading_letter_penalty = -15; // maximum penalty for leading letters
-            const int unmatched_letter_penalty = -1;    // penalty for every letter that doesn't matter
+        // Return best result
+        if (recursiveMatch && (!matched || bestRecursiveScore > outScore)) {
+            // Recursive score is better than "this". Only the entries it wrote differ.
+            memcpy(matches + bestRecursiveStart, bestRecursiveMatches + bestRecursiveStart, (patternLen - bestRecursiveStart) * sizeof(IndexT));
+            outScore = bestRecursiveScore;
+            return true;
+        }
+        else if (matched) {
+            // "this" score is better than recursive
+            return true;
+        }
+        else {
+            // no match
+            return false;
+        }
+    }
 
-            // Iterate str to end
-            while (*str != '\0')
-                ++str;
+    // Walks the branches a frame would spawn from str onwards without scoring them. Counts recursions exactly like
+    // fuzzy_match_recursive so the branches scored after a pruned one are the same as without minScore.
+    template <typename CharT>
+    static void fuzzy_internal::skip_branches(const CharT * pattern, const CharT * str, const CharT * strEnd, int & recursionCount, int recursionLimit)
+    {
+        while (*pattern != '\0' && str != strEnd && recursionCount < recursionLimit) {
+            if (*pattern == fold_case(*str)) {
+                // Branch that skips this match
+                if (++recursionCount < recursionLimit)
+                    skip_branches(pattern, str + 1, strEnd, recursionCount, recursionLimit);
+                ++pattern;
+            }
+            ++str;
+        }
+    }
 
-            // Initialize score
-            outScore = 100;
+    template <typename Policy, typename CharT>
+    static int fuzzy_internal::position_bonus(const CharT * strBegin, int idx) {
+        if (idx == 0)
+            return Policy::first_letter_bonus;
 
-            // Apply leading letter penalty
-            int penalty = leading_letter_penalty * matches[0];
-            if (penalty < max_leading_letter_penalty)
-                penalty = max_leading_letter_penalty;
-            outScore += penalty;
+        int bonus = 0;
+        CharT neighbor = strBegin[idx - 1];
+        CharT curr = strBegin[idx];
 
-            // Apply unmatched penalty
-            int unmatched = (int)(str - strBegin) - nextMatch;
-            outScore += unmatched_letter_penalty * unmatched;
+        // Camel case
+        if (is_lower(neighbor) && is_upper(curr))
+            bonus += Policy::camel_bonus;
 
-            // Apply ordering bonuses
-            for (int i = 0; i < nextMatch; ++i) {
-                uint8_t currIdx = matches[i];
+        // Separator
+        if (Policy::is_separator(neighbor))
+            bonus += Policy::separator_bonus;
 
-                if (i > 0) {
-                    uint8_t prevIdx = matches[i - 1];
+        return bonus;
+    }
 
-                    // Sequential
-                    if (currIdx == (prevIdx + 1))
-                        outScore += sequential_bonus;
-                }
+    // Dynamic programming scorer
+    //   cell(i,j) = best score of pattern[0..i] where pattern[i] is matched at str[j], excluding unmatched penalty
+    //   cell(0,j) = 100 + leadingPenalty(j) + bonus(j)
+    //   cell(i,j) = bonus(j) + max(cell(i-1,j-1) + sequential_bonus, max(cell(i-1,k) for k < j-1))
+    //   score     = max(cell(n-1,j)) + unmatched_letter_penalty * (strLen - n)
+    // patternLower must already be folded. str is walked once. Each pattern character keeps the cell for the previous column and a running
+    // max of every column before that. Full table is only stored when the caller wants match indices.
+    template <typename Policy, typename IndexT>
+    static bool fuzzy_internal::fuzzy_match_dp(const char * patternLower, int patternLen, const char * str, int & outScore, IndexT * matches, int maxMatches, int minScore)
+    {
+        if (patternLen <= 0 || patternLen > maxMatches || *str == '\0')
+            return false;
+
+        // Reject on length alone before scanning
+        int strLen = 0;
+        if (minScore != fuzzy_no_match) {
+            strLen = (int)strlen(str);
+            if (fuzzy_score_upper_bound<Policy>(patternLen, strLen) < minScore)
+                return false;
+        }
+
+        // Full table (column-major) is only required to recover match indices
+        int stackTable[4096];
+        int * table = nullptr;
+        if (matches) {
+            strLen = (int)strlen(str);
+            if (strLen < patternLen)
+                return false;
+
+            size_t cells = (size_t)strLen * patternLen;
+            table = cells <= sizeof(stackTable) / sizeof(stackTable[0]) ? stackTable : (int*)malloc(cells * sizeof(int));
+            if (!table)
+                return false;
+        }
+
+        int prevColumn[256];    // cell(i, j-1)
+        int bestBefore[256];    // max(cell(i, k)) for k < j-1
+        for (int i = 0; i < patternLen; ++i) {
+            prevColumn[i] = invalid_score;
+            bestBefore[i] = invalid_score;
+        }
+
+        // Rows past the greedy prefix matched so far can't hold a cell yet
+        int reach = 0;
 
-                // Check for bonuses based on neighbor character value
-                if (currIdx > 0) {
-                    // Camel case
-                    char neighbor = strBegin[currIdx - 1];
-                    char curr = strBegin[currIdx];
-                    if (::islower(neighbor) && ::isupper(curr))
-                        outScore += camel_bonus;
-
-                    // Separator
-                    bool neighborSeparator = neighbor == '_' || neighbor == ' ';
-                    if (neighborSeparator)
-                        outScore += separator_bonus;
+        int j = 0;
+        for (; str[j] != '\0'; ++j) {
+            char lower = fold_case(str[j]);
+
+            // Walk pattern backwards so row i-1 still holds column j-1
+            int top = table || reach >= patternLen ? patternLen - 1 : reach;
+            for (int i = top; i >= 0; --i) {
+                int cell = invalid_score;
+                if (i <= reach && patternLower[i] == lower) {
+                    int bonus = position_bonus<Policy>(str, j);
+                    if (i == 0) {
+                        int penalty = Policy::leading_letter_penalty * j;
+                        if (penalty < Policy::max_leading_letter_penalty)
+                            penalty = Policy::max_leading_letter_penalty;
+                        cell = 100 + penalty + bonus;
+                    }
+                    else {
+                        int prev = bestBefore[i - 1];
+                        if (prevColumn[i - 1] != invalid_score && prevColumn[i - 1] + Policy::sequential_bonus > prev)
+                            prev = prevColumn[i - 1] + Policy::sequential_bonus;
+                        if (prev != invalid_score)
+                            cell = prev + bonus;
+                    }
                 }
-                else {
-                    // First letter
-                    outScore += first_letter_bonus;
+
+                if (prevColumn[i] > bestBefore[i])
+                    bestBefore[i] = prevColumn[i];
+                prevColumn[i] = cell;
+
+                if (table)
+                    table[j * patternLen + i] = cell;
+            }
+
+            if (reach < patternLen && patternLower[reach] == lower)
+                ++reach;
+        }
+        strLen = j;
+
+        // Best cell for last pattern character
+        int last = patternLen - 1;
+        int best = bestBefore[last] > prevColumn[last] ? bestBefore[last] : prevColumn[last];
+        if (best == invalid_score || best + Policy::unmatched_letter_penalty * (strLen - patternLen) < minScore) {
+            if (table && table != stackTable)
+                free(table);
+            return false;
+        }
+
+        outScore = best + Policy::unmatched_letter_penalty * (strLen - patternLen);
+
+        // Walk table backwards to recover match indices
+        if (table) {
+            int col = 0;
+            while (table[col * patternLen + last] != best)
+                ++col;
+            matches[last] = (IndexT)col;
+
+            for (int i = last; i > 0; --i) {
+                int target = table[col * patternLen + i] - position_bonus<Policy>(str, col);
+                int prev = col - 1;
+                if (table[prev * patternLen + i - 1] == invalid_score || table[prev * patternLen + i - 1] + Policy::sequential_bonus != target) {
+                    prev = 0;
+                    while (table[prev * patternLen + i - 1] != target)
+                        ++prev;
                 }
+                col = prev;
+                matches[i - 1] = (IndexT)col;
             }
+
+            if (table != stackTable)
+                free(table);
         }
 
-        // Return best result
-        if (recursiveMatch && (!matched || bestRecursiveScore > outScore)) {
-            // Recursive score is better than "this"
-            memcpy(matches, bestRecursiveMatches, maxMatches);
-            outScore = bestRecursiveScore;
-            return true;
+        return true;
+    }
+
+    // fuzzy_match_dp with one string per 16-bit lane. Column j of every string is processed in one step and each pattern
+    // row is a handful of vector operations. With FuzzyDefaultScoring a reachable cell is at least 100 plus the capped
+    // leading penalty, so it is always positive and a pattern of 256 characters stays far below the int16_t limit.
+    // Unreachable cells start at SHRT_MIN. Saturating adds keep them negative, so max() never prefers them over a real
+    // cell and a final value <= 0 means no match. Lanes past the end of their string see '\0', which matches nothing.
+#if defined(FTS_FUZZY_MATCH_AVX2)
+    static void fuzzy_internal::fuzzy_match_dp_lanes(const char * patternLower, int patternLen, const char * const * strs, int count, int * outScores) {
+        typedef FuzzyDefaultScoring Policy;
+        const __m256i invalid = _mm256_set1_epi16(SHRT_MIN);
+        const __m256i sequential = _mm256_set1_epi16(Policy::sequential_bonus);
+
+        __m256i prevColumn[256];
+        __m256i bestBefore[256];
+        for (int i = 0; i < patternLen; ++i) {
+            prevColumn[i] = invalid;
+            bestBefore[i] = invalid;
         }
-        else if (matched) {
-            // "this" score is better than recursive
-            return true;
+
+        const char * cursor[dp_lanes];
+        for (int lane = 0; lane < dp_lanes; ++lane)
+            cursor[lane] = lane < count ? strs[lane] : "";
+
+        // position_bonus per lane from character classes of this column and the previous one
+        const __m256i lowerBit = _mm256_set1_epi16(char_lower);
+        const __m256i upperBit = _mm256_set1_epi16(char_upper);
+        const __m256i separatorBit = _mm256_set1_epi16(char_separator);
+        const __m256i camel = _mm256_set1_epi16(Policy::camel_bonus);
+        const __m256i separator = _mm256_set1_epi16(Policy::separator_bonus);
+        __m256i prevClasses = _mm256_setzero_si256();
+
+        int16_t chars[dp_lanes];
+        int16_t classes[dp_lanes];
+        for (int j = 0; ; ++j) {
+            // Transpose column j. Finished lanes stay parked on their '\0'.
+            int active = 0;
+            for (int lane = 0; lane < dp_lanes; ++lane) {
+                uint8_t c = (uint8_t)*cursor[lane];
+                chars[lane] = (uint8_t)fold_table[c];
+                classes[lane] = class_table[c];
+                cursor[lane] += c != 0;
+                active |= c;
+            }
+            if (!active)
+                break;
+
+            __m256i lower = _mm256_loadu_si256((const __m256i*)chars);
+            __m256i currClasses = _mm256_loadu_si256((const __m256i*)classes);
+            __m256i bonus = _mm256_set1_epi16(Policy::first_letter_bonus);
+            if (j > 0) {
+                __m256i camelCase = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(prevClasses, lowerBit), lowerBit), _mm256_cmpeq_epi16(_mm256_and_si256(currClasses, upperBit), upperBit));
+                __m256i afterSeparator = _mm256_cmpeq_epi16(_mm256_and_si256(prevClasses, separatorBit), separatorBit);
+                bonus = _mm256_adds_epi16(_mm256_and_si256(camelCase, camel), _mm256_and_si256(afterSeparator, separator));
+            }
+            prevClasses = currClasses;
+
+            int penalty = Policy::leading_letter_penalty * j;
+            if (penalty < Policy::max_leading_letter_penalty)
+                penalty = Policy::max_leading_letter_penalty;
+            const __m256i first = _mm256_adds_epi16(_mm256_set1_epi16((int16_t)(100 + penalty)), bonus);
+
+            // Walk pattern backwards so row i-1 still holds column j-1
+            for (int i = patternLen - 1; i >= 0; --i) {
+                __m256i hit = _mm256_cmpeq_epi16(lower, _mm256_set1_epi16((uint8_t)patternLower[i]));
+                __m256i cell = first;
+                if (i > 0)
+                    cell = _mm256_adds_epi16(_mm256_max_epi16(bestBefore[i - 1], _mm256_adds_epi16(prevColumn[i - 1], sequential)), bonus);
+                cell = _mm256_blendv_epi8(invalid, cell, hit);
+
+                bestBefore[i] = _mm256_max_epi16(bestBefore[i], prevColumn[i]);
+                prevColumn[i] = cell;
+            }
         }
-        else {
-            // no match
-            return false;
+
+        int16_t best[dp_lanes];
+        _mm256_storeu_si256((__m256i*)best, _mm256_max_epi16(bestBefore[patternLen - 1], prevColumn[patternLen - 1]));
+        for (int lane = 0; lane < count; ++lane) {
+            int strLen = (int)(cursor[lane] - strs[lane]);
+            outScores[lane] = best[lane] > 0 ? best[lane] + Policy::unmatched_letter_penalty * (strLen - patternLen) : fuzzy_no_match;
+        }
+    }
+#elif defined(FTS_FUZZY_MATCH_SSE2)
+    static void fuzzy_internal::fuzzy_match_dp_lanes(const char * patternLower, int patternLen, const char * const * strs, int count, int * outScores) {
+        typedef FuzzyDefaultScoring Policy;
+        const __m128i invalid = _mm_set1_epi16(SHRT_MIN);
+        const __m128i sequential = _mm_set1_epi16(Policy::sequential_bonus);
+
+        __m128i prevColumn[256];
+        __m128i bestBefore[256];
+        for (int i = 0; i < patternLen; ++i) {
+            prevColumn[i] = invalid;
+            bestBefore[i] = invalid;
+        }
+
+        const char * cursor[dp_lanes];
+        for (int lane = 0; lane < dp_lanes; ++lane)
+            cursor[lane] = lane < count ? strs[lane] : "";
+
+        // position_bonus per lane from character classes of this column and the previous one
+        const __m128i lowerBit = _mm_set1_epi16(char_lower);
+        const __m128i upperBit = _mm_set1_epi16(char_upper);
+        const __m128i separatorBit = _mm_set1_epi16(char_separator);
+        const __m128i camel = _mm_set1_epi16(Policy::camel_bonus);
+        const __m128i separator = _mm_set1_epi16(Policy::separator_bonus);
+        __m128i prevClasses = _mm_setzero_si128();
+
+        int16_t chars[dp_lanes];
+        int16_t classes[dp_lanes];
+        for (int j = 0; ; ++j) {
+            // Transpose column j. Finished lanes stay parked on their '\0'.
+            int active = 0;
+            for (int lane = 0; lane < dp_lanes; ++lane) {
+                uint8_t c = (uint8_t)*cursor[lane];
+                chars[lane] = (uint8_t)fold_table[c];
+                classes[lane] = class_table[c];
+                cursor[lane] += c != 0;
+                active |= c;
+            }
+            if (!active)
+                break;
+
+            __m128i lower = _mm_loadu_si128((const __m128i*)chars);
+            __m128i currClasses = _mm_loadu_si128((const __m128i*)classes);
+            __m128i bonus = _mm_set1_epi16(Policy::first_letter_bonus);
+            if (j > 0) {
+                __m128i camelCase = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(prevClasses, lowerBit), lowerBit), _mm_cmpeq_epi16(_mm_and_si128(currClasses, upperBit), upperBit));
+                __m128i afterSeparator = _mm_cmpeq_epi16(_mm_and_si128(prevClasses, separatorBit), separatorBit);
+                bonus = _mm_adds_epi16(_mm_and_si128(camelCase, camel), _mm_and_si128(afterSeparator, separator));
+            }
+            prevClasses = currClasses;
+
+            int penalty = Policy::leading_letter_penalty * j;
+            if (penalty < Policy::max_leading_letter_penalty)
+                penalty = Policy::max_leading_letter_penalty;
+            const __m128i first = _mm_adds_epi16(_mm_set1_epi16((int16_t)(100 + penalty)), bonus);
+
+            // Walk pattern backwards so row i-1 still holds column j-1. SSE2 has no blend so select with and/andnot.
+            for (int i = patternLen - 1; i >= 0; --i) {
+                __m128i hit = _mm_cmpeq_epi16(lower, _mm_set1_epi16((uint8_t)patternLower[i]));
+                __m128i cell = first;
+                if (i > 0)
+                    cell = _mm_adds_epi16(_mm_max_epi16(bestBefore[i - 1], _mm_adds_epi16(prevColumn[i - 1], sequential)), bonus);
+                cell = _mm_or_si128(_mm_and_si128(hit, cell), _mm_andnot_si128(hit, invalid));
+
+                bestBefore[i] = _mm_max_epi16(bestBefore[i], prevColumn[i]);
+                prevColumn[i] = cell;
+            }
+        }
+
+        int16_t best[dp_lanes];
+        _mm_storeu_si128((__m128i*)best, _mm_max_epi16(bestBefore[patternLen - 1], prevColumn[patternLen - 1]));
+        for (int lane = 0; lane < count; ++lane) {
+            int strLen = (int)(cursor[lane] - strs[lane]);
+            outScores[lane] = best[lane] > 0 ? best[lane] + Policy::unmatched_letter_penalty * (strLen - patternLen) : fuzzy_no_match;
+        }
+    }
+#else
+    static void fuzzy_internal::fuzzy_match_dp_lanes(const char * patternLower, int patternLen, const char * const * strs, int count, int * outScores) {
+        for (int lane = 0; lane < count; ++lane) {
+            int score;
+            bool matched = fuzzy_match_dp<FuzzyDefaultScoring, uint8_t>(patternLower, patternLen, strs[lane], score, nullptr, 256, fuzzy_no_match);
+            outScores[lane] = matched ? score : fuzzy_no_match;
         }
     }
+#endif
 } // namespace fts
 
 #endif // FTS_FUZZY_MATCH_IMPLEMENTATION
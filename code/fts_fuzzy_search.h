@@ -0,0 +1,952 @@
+// LICENSE
+//
+//   This software is dual-licensed to the public domain and under the following
+//   license: you are granted a perpetual, irrevocable license to copy, modify,
+//   publish, and distribute this file as you see fit.
+//
+// NOTES
+//   Compiling
+//     You MUST add '#define FTS_FUZZY_SEARCH_IMPLEMENTATION' before including this header in ONE source file to create implementation.
+//     Requires fts_fuzzy_match.h. Both implementations must be defined in the same source file, match first, because
+//     this one calls helpers in fuzzy_internal such as fold_case. With fts_fuzzy_corpus.h the order is match, search, corpus:
+//       #define FTS_FUZZY_MATCH_IMPLEMENTATION
+//       #define FTS_FUZZY_SEARCH_IMPLEMENTATION
+//       #include "fts_fuzzy_match.h"
+//       #include "fts_fuzzy_search.h"
+//     Unlike fts_fuzzy_match.h this file uses C++11 and the STL.
+//
+//   FuzzyResult
+//     Index of a matched string and its score. Results are ordered by score, highest first. Ties are ordered by index.
+//
+//   FuzzyCorpusView
+//     Non-owning pointers into a corpus built by fts_fuzzy_corpus.h. Valid as long as the memory it points at.
+//     Every class below also takes a view instead of a string array. Strings are then rejected on the stored length
+//     and the folded copy before they are scored, and results are identical to the string array versions.
+//
+//   FuzzyTopK
+//     Bounded min-heap holding the best K results offered so far.
+//     threshold() is the score a new result must exceed to be kept. It is fuzzy_no_match until K results are held.
+//
+//   fuzzy_match_top_k(...)
+//     Scores one pattern against an array of strings and keeps only the best K matches.
+//     Once K results are held the top-K threshold is passed to the scorer as minScore so most strings are skipped early.
+//     Pruning never changes a score that reaches minScore, so results are identical to FuzzySearchPool::top_k(...).
+//     signatures may be nullptr. Otherwise it must hold fuzzy_signature(...) for each string.
+//     Writes up to K results to outResults, already ordered. Returns the number of results written.
+//
+//   FuzzySearchPool
+//     Worker pool for searching large arrays of strings on several threads. The calling thread is worker 0.
+//     parallel_for(...) splits [0, count) into chunks of chunkSize. Each worker starts on its own contiguous run of
+//     chunks and takes them front to back. A worker that runs out steals chunks from the back of another worker's run.
+//     top_k(...) gives each worker its own FuzzyTopK then merges them. Strings are only skipped by signature or by
+//     fuzzy_score_upper_bound so every score equals fuzzy_match(...). Results are identical for any thread count.
+//     top_k(...) on a FuzzyCorpusView is what fuzzy_match_top_k(...) with a pool calls in fts_fuzzy_corpus.h.
+//
+//   FuzzyIncrementalSearch
+//     Stateful search for a pattern that is typed one character at a time. Keeps a stack of levels, one per pattern
+//     searched, each holding the indices of strings that matched it. A string that fails "fo" also fails "foo", so
+//     extending the pattern only rescans the survivors of the deepest level whose pattern is a prefix of the new one.
+//     Backspace pops back to a cached level without scanning anything.
+//
+//   FuzzyMultiSearch
+//     Set of patterns searched together in one pass over an array of strings. Each string is loaded once and tested
+//     against every pattern while it is still in cache. Work that doesn't depend on the pattern is shared: the string's
+//     signature, its length, and a folded copy are computed at most once per string. Each pattern's signature test is
+//     one AND against a packed array of pattern masks. Survivors must contain the pattern in the folded copy and have a
+//     length bound above the pattern's current threshold before they are scored. Scoring reads the original string and
+//     folds each character again, because camel case bonuses depend on the original case.
+//     top_k(...) writes one list per pattern, in the order patterns were added. Each list is identical to
+//     fuzzy_match_top_k(...) for that pattern alone.
+//
+//   FuzzyAsyncSearch
+//     Top K search split into slices so a UI thread never blocks on a large array. Same idea as ftsFuzzyMatchAsync in
+//     fts_fuzzy_match.js. start(...) resets the search. step(budget) scores strings in blocks of 1024 and returns once
+//     the budget in milliseconds is used up or the search is done. The clock is only read between blocks. flush()
+//     finishes the search on the calling thread. cancel() stops it after the current block. results() returns the best
+//     K found so far at any time. Final results are identical to fuzzy_match_top_k(...).
+//     run_background(onComplete) finishes the search on its own thread instead and calls onComplete from that thread
+//     unless the search is cancelled first. While it runs, step(...) does nothing and flush() waits for it.
+//     start(...), cancel(), and the destructor wait for the thread, so onComplete must not call them.
+
+
+#ifndef FTS_FUZZY_SEARCH_H
+#define FTS_FUZZY_SEARCH_H
+
+
+#include "fts_fuzzy_match.h"
+
+#include <cstddef>              // size_t
+#include <vector>               // std::vector
+#include <algorithm>            // std::push_heap, std::pop_heap, std::sort_heap
+#include <atomic>               // std::atomic
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+#include <functional>           // std::function
+#include <memory>               // std::unique_ptr
+#include <string>               // std::string
+#include <chrono>               // std::chrono::steady_clock
+
+// Public interface
+namespace fts {
+
+    struct FuzzyResult {
+        int score;
+        int index;
+    };
+
+    struct FuzzyCorpusView {
+        int count;
+        size_t blobSize;            // bytes in each blob
+        char const * blob;
+        char const * foldedBlob;
+        uint32_t const * offsets;
+        uint32_t const * lengths;
+        uint64_t const * signatures;
+
+        char const * string(int i) const { return blob + offsets[i]; }
+        char const * folded(int i) const { return foldedBlob + offsets[i]; }
+        int length(int i) const { return (int)lengths[i]; }
+    };
+
+    class FuzzyTopK {
+      public:
+        explicit FuzzyTopK(int maxResults);
+
+        void clear();
+        bool offer(int score, int index);
+        int threshold() const;
+
+        int capacity() const { return k; }
+        int size() const { return (int)heap.size(); }
+        bool full() const { return (int)heap.size() >= k; }
+
+        // Moves results out ordered best first. Leaves the heap empty.
+        std::vector<FuzzyResult> take();
+
+      private:
+        std::vector<FuzzyResult> heap;  // worst result at front
+        int k;
+    };
+
+    class FuzzySearchPool {
+      public:
+        explicit FuzzySearchPool(int threadCount = 0, int chunkSize = 4096);   // 0 threads = hardware concurrency
+        ~FuzzySearchPool();
+
+        FuzzySearchPool(FuzzySearchPool const &) = delete;
+        FuzzySearchPool & operator=(FuzzySearchPool const &) = delete;
+
+        int thread_count() const { return threadCount; }
+        int chunk_size() const { return chunkSize; }
+
+        // Calls process(worker, begin, end) for every chunk of [0, count). Returns when all chunks are done.
+        void parallel_for(int count, std::function<void(int worker, int begin, int end)> const & process);
+
+        int top_k(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int k, FuzzyResult * outResults);
+        int top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults);
+
+      private:
+        // Run of chunks owned by one worker. front and back are packed into one word so owner and thieves can race.
+        struct ChunkRun {
+            std::atomic<uint64_t> range;
+            char padding[64 - sizeof(std::atomic<uint64_t>)];
+        };
+
+        void worker_main(int worker);
+        void work(int worker);
+        int pop_front(int worker);
+        int steal_back(int victim);
+
+        int threadCount;
+        int chunkSize;
+        std::vector<std::thread> threads;
+        std::unique_ptr<ChunkRun[]> runs;
+
+        // Current job
+        std::function<void(int, int, int)> const * job;
+        int jobCount;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t generation;
+        int busyWorkers;
+        bool quit;
+    };
+
+    class FuzzyIncrementalSearch {
+      public:
+        FuzzyIncrementalSearch(char const * const * candidates, uint64_t const * signatures, int count);
+        explicit FuzzyIncrementalSearch(FuzzyCorpusView const & corpus);
+
+        // Returns number of strings matching pattern
+        int set_pattern(char const * pattern);
+        void reset();
+
+        // Indices of strings matching the current pattern, in index order
+        std::vector<int> const & matches() const;
+
+        // Best K of the current matches by fuzzy_match score
+        int top_k(int k, FuzzyResult * outResults) const;
+
+        int level_count() const { return (int)levels.size(); }
+        int last_scan_count() const { return lastScanCount; }
+
+      private:
+        struct Level {
+            std::string pattern;        // folded
+            std::vector<int> survivors;
+        };
+
+        bool is_match(FuzzyPattern const & compiled, int i) const;
+
+        char const * const * candidates;    // nullptr when searching corpus
+        FuzzyCorpusView corpus;
+        uint64_t const * signatures;
+        int count;
+
+        std::vector<Level> levels;
+        mutable std::vector<int> all;   // survivors of the empty pattern. Filled on first use.
+        int lastScanCount;              // strings scanned by last set_pattern. 0 if served from cache.
+    };
+
+    class FuzzyMultiSearch {
+      public:
+        FuzzyMultiSearch() {}
+        FuzzyMultiSearch(char const * const * patterns, int count);
+
+        // Returns index of the pattern's result list
+        int add(char const * pattern);
+        void clear();
+
+        int size() const { return (int)patterns.size(); }
+
+        // signatures may be nullptr. outResults is resized to size() lists, each ordered best first.
+        void top_k(char const * const * candidates, uint64_t const * signatures, int count, int k, std::vector<std::vector<FuzzyResult>> & outResults) const;
+        void top_k(FuzzyCorpusView const & corpus, int k, std::vector<std::vector<FuzzyResult>> & outResults) const;
+
+      private:
+        // Offers string index to every pattern whose signature it passes. folded is str folded to lower case.
+        void offer(char const * str, int strLen, char const * folded, uint64_t signature, int index, std::vector<FuzzyTopK> & tops) const;
+        bool might_match_any(uint64_t signature) const;
+
+        std::vector<FuzzyPattern> patterns;
+        std::vector<uint64_t> masks;    // signature mask of each pattern, all bits for patterns that can't match
+    };
+
+    class FuzzyAsyncSearch {
+      public:
+        FuzzyAsyncSearch(char const * const * candidates, uint64_t const * signatures, int count);
+        explicit FuzzyAsyncSearch(FuzzyCorpusView const & corpus);
+        ~FuzzyAsyncSearch();
+
+        FuzzyAsyncSearch(FuzzyAsyncSearch const &) = delete;
+        FuzzyAsyncSearch & operator=(FuzzyAsyncSearch const &) = delete;
+
+        // Cancels any search in progress
+        void start(char const * pattern, int k);
+
+        // Returns true once there is nothing left to score
+        bool step(double budgetMilliseconds);
+        void flush();
+        void cancel();
+        void run_background(std::function<void(std::vector<FuzzyResult> const &)> onComplete);
+
+        bool done() const;
+        int scanned() const;
+
+        // Best K so far, ordered best first
+        std::vector<FuzzyResult> results() const;
+
+      private:
+        bool scan_block();      // false once finished or cancelled
+        void join();
+
+        char const * const * candidates;    // nullptr when searching corpus
+        FuzzyCorpusView corpus;
+        uint64_t const * signatures;
+        int count;
+
+        mutable std::mutex mutex;               // guards compiled, top, and next
+        std::unique_ptr<FuzzyPattern> compiled;
+        FuzzyTopK top;
+        int next;
+        std::atomic<bool> cancelled;
+        std::thread background;
+    };
+
+    static bool fuzzy_result_better(FuzzyResult const & a, FuzzyResult const & b);
+    static int fuzzy_match_top_k(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int k, FuzzyResult * outResults);
+}
+
+
+#ifdef FTS_FUZZY_SEARCH_IMPLEMENTATION
+namespace fts {
+
+    // Forward declarations for "private" implementation
+    namespace fuzzy_internal {
+        const int async_block_size = 1024;  // strings scored between clock and cancel checks
+        const int corpus_prefetch_distance = 8;
+
+        static bool folded_subsequence(char const * patternLower, char const * strLower);
+        static void corpus_top_k(FuzzyPattern const & compiled, FuzzyCorpusView const & corpus, int begin, int end, bool inOrder, FuzzyTopK & top);
+        static void corpus_offer(FuzzyPattern const & compiled, FuzzyCorpusView const & corpus, int i, int index, bool inOrder, FuzzyTopK & top);
+        static void prefetch(void const * address);
+        static int write_top_k(FuzzyTopK & top, FuzzyResult * outResults);
+        static int merge_top_k(std::vector<FuzzyTopK> & local, int k, FuzzyResult * outResults);
+    }
+
+    // Public interface
+    static bool fuzzy_result_better(FuzzyResult const & a, FuzzyResult const & b) {
+        if (a.score != b.score)
+            return a.score > b.score;
+        return a.index < b.index;
+    }
+
+    static int fuzzy_match_top_k(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int k, FuzzyResult * outResults) {
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        FuzzyTopK top(k);
+        for (int i = 0; i < count; ++i) {
+            if (signatures && !compiled.might_match(signatures[i]))
+                continue;
+
+            // Ties are ordered by index so a later string must beat the threshold
+            int threshold = top.threshold();
+            int minScore = threshold == fuzzy_no_match ? fuzzy_no_match : threshold + 1;
+
+            int score;
+            if (compiled.match(candidates[i], score, minScore))
+                top.offer(score, i);
+        }
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    // FuzzyTopK
+    FuzzyTopK::FuzzyTopK(int maxResults)
+        : k(maxResults > 0 ? maxResults : 0)
+    {
+        heap.reserve(k);
+    }
+
+    void FuzzyTopK::clear() {
+        heap.clear();
+    }
+
+    bool FuzzyTopK::offer(int score, int index) {
+        if (k == 0)
+            return false;
+
+        FuzzyResult result = { score, index };
+        if ((int)heap.size() < k) {
+            heap.push_back(result);
+            std::push_heap(heap.begin(), heap.end(), fuzzy_result_better);
+            return true;
+        }
+
+        // Replace worst result if new one is better
+        if (!fuzzy_result_better(result, heap.front()))
+            return false;
+
+        std::pop_heap(heap.begin(), heap.end(), fuzzy_result_better);
+        heap.back() = result;
+        std::push_heap(heap.begin(), heap.end(), fuzzy_result_better);
+        return true;
+    }
+
+    int FuzzyTopK::threshold() const {
+        return full() && k > 0 ? heap.front().score : fuzzy_no_match;
+    }
+
+    std::vector<FuzzyResult> FuzzyTopK::take() {
+        // sort_heap with a "better" comparator leaves best first
+        std::sort_heap(heap.begin(), heap.end(), fuzzy_result_better);
+        std::vector<FuzzyResult> results;
+        results.swap(heap);
+        heap.reserve(k);
+        return results;
+    }
+
+    // FuzzySearchPool
+    FuzzySearchPool::FuzzySearchPool(int threadCount, int chunkSize)
+        : threadCount(threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency())
+        , chunkSize(chunkSize > 0 ? chunkSize : 4096)
+        , job(nullptr)
+        , jobCount(0)
+        , generation(0)
+        , busyWorkers(0)
+        , quit(false)
+    {
+        if (this->threadCount < 1)
+            this->threadCount = 1;
+
+        runs.reset(new ChunkRun[this->threadCount]);
+        for (int i = 0; i < this->threadCount; ++i)
+            runs[i].range = 0;
+
+        // Worker 0 is the calling thread
+        for (int i = 1; i < this->threadCount; ++i)
+            threads.emplace_back(&FuzzySearchPool::worker_main, this, i);
+    }
+
+    FuzzySearchPool::~FuzzySearchPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+
+        for (auto && thread : threads)
+            thread.join();
+    }
+
+    void FuzzySearchPool::parallel_for(int count, std::function<void(int, int, int)> const & process) {
+        if (count <= 0)
+            return;
+
+        // Hand each worker an equal contiguous run of chunks
+        int chunks = (count + chunkSize - 1) / chunkSize;
+        for (int i = 0; i < threadCount; ++i) {
+            uint64_t front = (uint64_t)chunks * i / threadCount;
+            uint64_t back = (uint64_t)chunks * (i + 1) / threadCount;
+            runs[i].range = (back << 32) | front;
+        }
+
+        if (threadCount == 1) {
+            job = &process;
+            jobCount = count;
+            work(0);
+            job = nullptr;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &process;
+            jobCount = count;
+            busyWorkers = threadCount - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+    int FuzzySearchPool::top_k(char const * pattern, char const * const * candidates, uint64_t const * signatures, int count, int k, FuzzyResult * outResults) {
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        std::vector<FuzzyTopK> local(threadCount, FuzzyTopK(k));
+        parallel_for(count, [&](int worker, int begin, int end) {
+            FuzzyTopK & top = local[worker];
+            for (int i = begin; i < end; ++i) {
+                if (signatures && !compiled.might_match(signatures[i]))
+                    continue;
+
+                // Chunks arrive out of order so an equal score may still win on index. Only skip strictly lower bounds.
+                int threshold = top.threshold();
+                if (threshold != fuzzy_no_match && fuzzy_score_upper_bound(compiled.length(), (int)strlen(candidates[i])) < threshold)
+                    continue;
+
+                int score;
+                if (compiled.match(candidates[i], score))
+                    top.offer(score, i);
+            }
+        });
+
+        return fuzzy_internal::merge_top_k(local, k, outResults);
+    }
+
+    int FuzzySearchPool::top_k(char const * pattern, FuzzyCorpusView const & corpus, int k, FuzzyResult * outResults) {
+        FuzzyPattern compiled(pattern);
+        if (!compiled.valid() || k <= 0)
+            return 0;
+
+        std::vector<FuzzyTopK> local(threadCount, FuzzyTopK(k));
+        parallel_for(corpus.count, [&](int worker, int begin, int end) {
+            fuzzy_internal::corpus_top_k(compiled, corpus, begin, end, false, local[worker]);
+        });
+
+        return fuzzy_internal::merge_top_k(local, k, outResults);
+    }
+
+    // FuzzyIncrementalSearch
+    FuzzyIncrementalSearch::FuzzyIncrementalSearch(char const * const * candidates, uint64_t const * signatures, int count)
+        : candidates(candidates)
+        , corpus()
+        , signatures(signatures)
+        , count(count)
+        , lastScanCount(0)
+    {
+    }
+
+    FuzzyIncrementalSearch::FuzzyIncrementalSearch(FuzzyCorpusView const & corpus)
+        : candidates(nullptr)
+        , corpus(corpus)
+        , signatures(corpus.signatures)
+        , count(corpus.count)
+        , lastScanCount(0)
+    {
+    }
+
+    int FuzzyIncrementalSearch::set_pattern(char const * pattern) {
+        FuzzyPattern compiled(pattern);
+        lastScanCount = 0;
+
+        // Fold here as well. FuzzyPattern is empty for patterns it can't handle.
+        std::string folded = pattern;
+        for (char & c : folded)
+            c = fuzzy_internal::fold_case(c);
+
+        // Drop levels that aren't a prefix of the new pattern. Handles backspace and edits.
+        while (!levels.empty() && folded.compare(0, levels.back().pattern.size(), levels.back().pattern) != 0)
+            levels.pop_back();
+
+        // Empty pattern matches everything
+        if (folded.empty()) {
+            levels.clear();
+            return (int)matches().size();
+        }
+
+        // Cached
+        if (!levels.empty() && levels.back().pattern == folded)
+            return (int)levels.back().survivors.size();
+
+        // Pattern too long for FuzzyPattern matches nothing
+        Level level;
+        level.pattern = folded;
+        if (compiled.valid()) {
+            if (levels.empty()) {
+                // Full scan
+                lastScanCount = count;
+                for (int i = 0; i < count; ++i)
+                    if (is_match(compiled, i))
+                        level.survivors.push_back(i);
+            }
+            else {
+                // Rescan previous survivors only
+                std::vector<int> const & previous = levels.back().survivors;
+                lastScanCount = (int)previous.size();
+                for (int i : previous)
+                    if (is_match(compiled, i))
+                        level.survivors.push_back(i);
+            }
+        }
+
+        levels.push_back(std::move(level));
+        return (int)levels.back().survivors.size();
+    }
+
+    void FuzzyIncrementalSearch::reset() {
+        levels.clear();
+        lastScanCount = 0;
+    }
+
+    std::vector<int> const & FuzzyIncrementalSearch::matches() const {
+        if (!levels.empty())
+            return levels.back().survivors;
+
+        // Built lazily since most users never ask for the empty pattern
+        if ((int)all.size() != count) {
+            all.resize(count);
+            for (int i = 0; i < count; ++i)
+                all[i] = i;
+        }
+        return all;
+    }
+
+    int FuzzyIncrementalSearch::top_k(int k, FuzzyResult * outResults) const {
+        if (levels.empty() || k <= 0)
+            return 0;
+
+        FuzzyPattern compiled(levels.back().pattern.c_str());
+        FuzzyTopK top(k);
+        for (int i : levels.back().survivors) {
+            if (!candidates) {
+                fuzzy_internal::corpus_offer(compiled, corpus, i, i, true, top);
+                continue;
+            }
+
+            // Survivors arrive in index order so equal bounds can't win
+            int threshold = top.threshold();
+            if (threshold != fuzzy_no_match && fuzzy_score_upper_bound(compiled.length(), (int)strlen(candidates[i])) <= threshold)
+                continue;
+
+            int score;
+            if (compiled.match(candidates[i], score))
+                top.offer(score, i);
+        }
+
+        return fuzzy_internal::write_top_k(top, outResults);
+    }
+
+    bool FuzzyIncrementalSearch::is_match(FuzzyPattern const & compiled, int i) const {
+        if (signatures && !compiled.might_match(signatures[i]))
+            return false;
+
+        // Corpus strings are rejected on the folded copy first
+        if (!candidates)
+            return fuzzy_internal::folded_subsequence(compiled.folded(), corpus.folded(i)) && compiled.match(corpus.string(i));
+        return compiled.match(candidates[i]);
+    }
+
+    // FuzzyMultiSearch
+    FuzzyMultiSearch::FuzzyMultiSearch(char const * const * patterns, int count) {
+        for (int i = 0; i < count; ++i)
+            add(patterns[i]);
+    }
+
+    int FuzzyMultiSearch::add(char const * pattern) {
+        patterns.emplace_back(pattern);
+        masks.push_back(patterns.back().valid() ? patterns.back().mask() : ~uint64_t(0));
+        return (int)patterns.size() - 1;
+    }
+
+    void FuzzyMultiSearch::clear() {
+        patterns.clear();
+        masks.clear();
+    }
+
+    void FuzzyMultiSearch::top_k(char const * const * candidates, uint64_t const * signatures, int count, int k, std::vector<std::vector<FuzzyResult>> & outResults) const {
+        int patternCount = (int)patterns.size();
+        outResults.assign(patternCount, std::vector<FuzzyResult>());
+        if (k <= 0 || patternCount == 0)
+            return;
+
+        std::vector<FuzzyTopK> tops(patternCount, FuzzyTopK(k));
+        std::vector<char> folded;
+        for (int i = 0; i < count; ++i) {
+            char const * str = candidates[i];
+            uint64_t signature = signatures ? signatures[i] : fuzzy_signature(str);
+
+            // Length and folded copy are only needed once some pattern passes the signature test
+            if (!might_match_any(signature))
+                continue;
+
+            int strLen = (int)strlen(str);
+            folded.resize(strLen + 1);
+            for (int j = 0; j <= strLen; ++j)
+                folded[j] = fuzzy_internal::fold_case(str[j]);
+
+            offer(str, strLen, folded.data(), signature, i, tops);
+        }
+
+        for (int p = 0; p < patternCount; ++p)
+            outResults[p] = tops[p].take();
+    }
+
+    void FuzzyMultiSearch::top_k(FuzzyCorpusView const & corpus, int k, std::vector<std::vector<FuzzyResult>> & outResults) const {
+        int patternCount = (int)patterns.size();
+        outResults.assign(patternCount, std::vector<FuzzyResult>());
+        if (k <= 0 || patternCount == 0)
+            return;
+
+        // Corpus already stores length and folded copy
+        std::vector<FuzzyTopK> tops(patternCount, FuzzyTopK(k));
+        for (int i = 0; i < corpus.count; ++i)
+            offer(corpus.string(i), corpus.length(i), corpus.folded(i), corpus.signatures[i], i, tops);
+
+        for (int p = 0; p < patternCount; ++p)
+            outResults[p] = tops[p].take();
+    }
+
+    void FuzzyMultiSearch::offer(char const * str, int strLen, char const * folded, uint64_t signature, int index, std::vector<FuzzyTopK> & tops) const {
+        int patternCount = (int)patterns.size();
+        for (int p = 0; p < patternCount; ++p) {
+            if ((signature & masks[p]) != masks[p] || !patterns[p].valid())
+                continue;
+
+            // Strings arrive in index order so ties can't win. Same minScore as fuzzy_match_top_k.
+            FuzzyPattern const & compiled = patterns[p];
+            int threshold = tops[p].threshold();
+            int minScore = threshold == fuzzy_no_match ? fuzzy_no_match : threshold + 1;
+            if (minScore != fuzzy_no_match && fuzzy_score_upper_bound(compiled.length(), strLen) < minScore)
+                continue;
+            if (!fuzzy_internal::folded_subsequence(compiled.folded(), folded))
+                continue;
+
+            int score;
+            if (compiled.match(str, score, minScore))
+                tops[p].offer(score, index);
+        }
+    }
+
+    bool FuzzyMultiSearch::might_match_any(uint64_t signature) const {
+        for (uint64_t mask : masks)
+            if ((signature & mask) == mask)
+                return true;
+        return false;
+    }
+
+    // FuzzyAsyncSearch
+    FuzzyAsyncSearch::FuzzyAsyncSearch(char const * const * candidates, uint64_t const * signatures, int count)
+        : candidates(candidates)
+        , corpus()
+        , signatures(signatures)
+        , count(count)
+        , top(0)
+        , next(0)
+        , cancelled(false)
+    {
+    }
+
+    FuzzyAsyncSearch::FuzzyAsyncSearch(FuzzyCorpusView const & corpus)
+        : candidates(nullptr)
+        , corpus(corpus)
+        , signatures(corpus.signatures)
+        , count(corpus.count)
+        , top(0)
+        , next(0)
+        , cancelled(false)
+    {
+    }
+
+    FuzzyAsyncSearch::~FuzzyAsyncSearch() {
+        cancel();
+    }
+
+    void FuzzyAsyncSearch::start(char const * pattern, int k) {
+        cancel();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        compiled.reset(new FuzzyPattern(pattern));
+        top = FuzzyTopK(k);
+        next = compiled->valid() && k > 0 ? 0 : count;
+        cancelled = false;
+    }
+
+    bool FuzzyAsyncSearch::step(double budgetMilliseconds) {
+        if (background.joinable())
+            return done();
+
+        auto stop = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budgetMilliseconds);
+        while (scan_block()) {
+            if (std::chrono::steady_clock::now() >= stop)
+                break;
+        }
+        return done();
+    }
+
+    void FuzzyAsyncSearch::flush() {
+        if (background.joinable()) {
+            join();
+            return;
+        }
+
+        while (scan_block()) {
+        }
+    }
+
+    void FuzzyAsyncSearch::cancel() {
+        cancelled = true;
+        join();
+    }
+
+    void FuzzyAsyncSearch::run_background(std::function<void(std::vector<FuzzyResult> const &)> onComplete) {
+        join();
+        background = std::thread([this, onComplete] {
+            while (scan_block()) {
+            }
+            if (!cancelled && onComplete)
+                onComplete(results());
+        });
+    }
+
+    bool FuzzyAsyncSearch::done() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !compiled || cancelled || next >= count;
+    }
+
+    int FuzzyAsyncSearch::scanned() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return compiled ? next : 0;
+    }
+
+    std::vector<FuzzyResult> FuzzyAsyncSearch::results() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        FuzzyTopK snapshot = top;
+        return snapshot.take();
+    }
+
+    bool FuzzyAsyncSearch::scan_block() {
+        // Lock is held for one block so results() never waits long
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!compiled || cancelled || next >= count)
+            return false;
+
+        int end = count - next > fuzzy_internal::async_block_size ? next + fuzzy_internal::async_block_size : count;
+        if (!candidates) {
+            fuzzy_internal::corpus_top_k(*compiled, corpus, next, end, true, top);
+            next = end;
+            return next < count;
+        }
+
+        for (int i = next; i < end; ++i) {
+            if (signatures && !compiled->might_match(signatures[i]))
+                continue;
+
+            // Blocks are scored in index order. Same minScore as fuzzy_match_top_k.
+            int threshold = top.threshold();
+            int minScore = threshold == fuzzy_no_match ? fuzzy_no_match : threshold + 1;
+
+            int score;
+            if (compiled->match(candidates[i], score, minScore))
+                top.offer(score, i);
+        }
+        next = end;
+        return next < count;
+    }
+
+    void FuzzyAsyncSearch::join() {
+        if (background.joinable())
+            background.join();
+    }
+
+    void FuzzySearchPool::worker_main(int worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+
+            work(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --busyWorkers;
+            }
+            done.notify_one();
+        }
+    }
+
+    void FuzzySearchPool::work(int worker) {
+        // Own chunks first, then steal
+        for (;;) {
+            int chunk = pop_front(worker);
+            for (int i = 1; chunk < 0 && i < threadCount; ++i)
+                chunk = steal_back((worker + i) % threadCount);
+            if (chunk < 0)
+                return;
+
+            int begin = chunk * chunkSize;
+            int end = begin + chunkSize < jobCount ? begin + chunkSize : jobCount;
+            (*job)(worker, begin, end);
+        }
+    }
+
+    int FuzzySearchPool::pop_front(int worker) {
+        std::atomic<uint64_t> & range = runs[worker].range;
+        uint64_t value = range.load();
+        for (;;) {
+            uint32_t front = (uint32_t)value;
+            uint32_t back = (uint32_t)(value >> 32);
+            if (front >= back)
+                return -1;
+            if (range.compare_exchange_weak(value, ((uint64_t)back << 32) | (front + 1)))
+                return (int)front;
+        }
+    }
+
+    int FuzzySearchPool::steal_back(int victim) {
+        std::atomic<uint64_t> & range = runs[victim].range;
+        uint64_t value = range.load();
+        for (;;) {
+            uint32_t front = (uint32_t)value;
+            uint32_t back = (uint32_t)(value >> 32);
+            if (front >= back)
+                return -1;
+            if (range.compare_exchange_weak(value, ((uint64_t)(back - 1) << 32) | front))
+                return (int)(back - 1);
+        }
+    }
+
+    // Private implementation
+    static bool fuzzy_internal::folded_subsequence(char const * patternLower, char const * strLower) {
+        while (*patternLower != '\0') {
+            strLower = strchr(strLower, *patternLower);
+            if (!strLower)
+                return false;
+            ++patternLower;
+            ++strLower;
+        }
+        return true;
+    }
+
+    // Offers strings [begin, end) to top. Strings are rejected by signature, stored length, then the folded copy.
+    // inOrder means no string before begin is offered later, so a string only has to beat the threshold, not tie it.
+    // Otherwise a tie may still win on index. Either way pruned scores equal fuzzy_match(...), so the result doesn't
+    // depend on which worker saw which chunk.
+    static void fuzzy_internal::corpus_top_k(FuzzyPattern const & compiled, FuzzyCorpusView const & corpus, int begin, int end, bool inOrder, FuzzyTopK & top) {
+        for (int i = begin; i < end; ++i) {
+            int ahead = i + corpus_prefetch_distance;
+            if (ahead < end && compiled.might_match(corpus.signatures[ahead]))
+                prefetch(corpus.folded(ahead));
+
+            corpus_offer(compiled, corpus, i, i, inOrder, top);
+        }
+    }
+
+    // Scores string i and offers it to top as index
+    static void fuzzy_internal::corpus_offer(FuzzyPattern const & compiled, FuzzyCorpusView const & corpus, int i, int index, bool inOrder, FuzzyTopK & top) {
+        if (!compiled.might_match(corpus.signatures[i]))
+            return;
+
+        // Stored length rejects without touching the string
+        int threshold = top.threshold();
+        int minScore = threshold == fuzzy_no_match || !inOrder ? threshold : threshold + 1;
+        if (threshold != fuzzy_no_match && fuzzy_score_upper_bound(compiled.length(), corpus.length(i)) < minScore)
+            return;
+
+        if (!folded_subsequence(compiled.folded(), corpus.folded(i)))
+            return;
+
+        int score;
+        if (compiled.match(corpus.string(i), score, minScore))
+            top.offer(score, index);
+    }
+
+    static void fuzzy_internal::prefetch(void const * address) {
+#if defined(FTS_FUZZY_MATCH_AVX2) || defined(FTS_FUZZY_MATCH_SSE2)
+        _mm_prefetch((char const *)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    // Writes results ordered best first. Returns the number written.
+    static int fuzzy_internal::write_top_k(FuzzyTopK & top, FuzzyResult * outResults) {
+        std::vector<FuzzyResult> results = top.take();
+        std::copy(results.begin(), results.end(), outResults);
+        return (int)results.size();
+    }
+
+    // Merges per worker lists. Order is fully defined by score then index so the result doesn't depend on scheduling.
+    static int fuzzy_internal::merge_top_k(std::vector<FuzzyTopK> & local, int k, FuzzyResult * outResults) {
+        FuzzyTopK merged(k);
+        for (auto && top : local)
+            for (auto && result : top.take())
+                merged.offer(result.score, result.index);
+
+        return write_top_k(merged, outResults);
+    }
+
+} // namespace fts
+
+#endif // FTS_FUZZY_SEARCH_IMPLEMENTATION
+
+#endif // FTS_FUZZY_SEARCH_H
@@ -8,8 +8,12 @@
 //   Forrest Smith
 
 #define FTS_FUZZY_MATCH_IMPLEMENTATION
+#define FTS_FUZZY_SEARCH_IMPLEMENTATION
+#define FTS_FUZZY_CORPUS_IMPLEMENTATION
 
 #include "..\..\code\fts_fuzzy_match.h"
+#include "..\..\code\fts_fuzzy_search.h"
+#include "..\..\code\fts_fuzzy_corpus.h"
 #include "..\..\code\util\fts_timer.h"
 
 #include <iostream>
@@ -18,17 +22,24 @@
 #include <vector>
 #include <unordered_map>
 #include <queue>
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 int main(int argc, char *argv[]) {
 
     // Dictionary
+    std::string path;
     std::vector<std::string> dictionary;
     
     auto countMatches = [&dictionary](std::string const & pattern) -> int { 
         int matches = 0;
+        fts::FuzzyPattern compiled(pattern.c_str());
         for (auto && entry : dictionary)
-            if (fts::fuzzy_match_simple(pattern.c_str(), entry.c_str()))
+            if (compiled.match(entry.c_str()))
                 ++matches;
 
         return matches; 
@@ -36,29 +47,599 @@ int main(int argc, char *argv[]) {
 
     auto alphabeticalMatches = [&dictionary](std::string const & pattern) {
         std::vector<std::string const *> matches;
+        fts::FuzzyPattern compiled(pattern.c_str());
         for (auto && entry : dictionary)
-            if (fts::fuzzy_match_simple(pattern.c_str(), entry.c_str()))
+            if (compiled.match(entry.c_str()))
                 matches.push_back(&entry);
 
         return matches;
     };
 
-    auto scoredMatches = [&dictionary](std::string const & pattern) {
+    // Top K lists agree if they hold the same indices with the same scores in the same order
+    auto sameResults = [](std::vector<fts::FuzzyResult> const & lhs, std::vector<fts::FuzzyResult> const & rhs) {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+            [](fts::FuzzyResult const & a, fts::FuzzyResult const & b) { return a.score == b.score && a.index == b.index; });
+    };
+
+    // Contiguous array of candidates for batch functions
+    std::vector<char const *> candidates;
+    std::vector<uint64_t> signatures;
+    std::vector<int> scores;
+
+    auto scoredMatches = [&dictionary, &candidates, &signatures, &scores](std::string const & pattern) {
         std::vector<std::pair<int, std::string const*>> matches;
+        scores.resize(candidates.size());
+        int count = fts::fuzzy_match_batch(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), scores.data());
+
+        matches.reserve(count);
+        for (size_t i = 0; i < scores.size(); ++i)
+            if (scores[i] != fts::fuzzy_no_match)
+                matches.emplace_back(scores[i], &dictionary[i]);
+
+        std::sort(matches.begin(), matches.end(), [](auto && a, auto && b) { return a.first > b.first; });
+        
+        return matches;
+    };
+
+    auto topMatches = [&candidates, &signatures](std::string const & pattern, int k) {
+        std::vector<fts::FuzzyResult> results(k);
+        int count = fts::fuzzy_match_top_k(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, results.data());
+        results.resize(count);
+        return results;
+    };
+
+    auto highlight = [](std::string const & pattern, std::string const & entry) {
+        // Positions are recomputed only for printed results. Matched characters are wrapped in brackets.
         int score;
+        fts::FuzzyMatchMask mask;
+        if (!fts::fuzzy_match(pattern.c_str(), entry.c_str(), score, mask))
+            return entry;
+
+        std::string marked;
+        for (int i = 0; i < (int)entry.size(); ++i) {
+            if (mask.test(i))
+                marked += '[' + std::string(1, entry[i]) + ']';
+            else
+                marked += entry[i];
+        }
+        return marked;
+    };
+
+    auto parallelScaling = [&candidates, &signatures, &sameResults](std::string const & pattern) {
+        // Time top 10 search across thread counts and check every count returns the same results as the serial search
+        const int k = 10;
+        const int runs = 5;
+        std::vector<fts::FuzzyResult> reference(k);
+        reference.resize(fts::fuzzy_match_top_k(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, reference.data()));
+
+        int hardwareThreads = (int)std::thread::hardware_concurrency();
+        std::vector<int> threadCounts = { 1, 2, 4, 8 };
+        if (hardwareThreads > 0 && std::find(threadCounts.begin(), threadCounts.end(), hardwareThreads) == threadCounts.end())
+            threadCounts.push_back(hardwareThreads);
+
+        double singleTime = 0;
+        for (int threads : threadCounts) {
+            fts::FuzzySearchPool pool(threads);
+            std::vector<fts::FuzzyResult> results(k);
+
+            fts::Stopwatch stopwatch;
+            int count = 0;
+            for (int run = 0; run < runs; ++run)
+                count = pool.top_k(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, results.data());
+            auto time = stopwatch.elapsedMilliseconds() / runs;
+            results.resize(count);
+
+            bool same = sameResults(results, reference);
+
+            // Throughput in millions of strings per second and speedup over the first thread count
+            if (singleTime == 0)
+                singleTime = time;
+            double throughput = time > 0 ? candidates.size() / (time * 1000.0) : 0.0;
+            double speedup = time > 0 ? singleTime / time : 0.0;
+            std::cout << threads << " threads: " << time << "ms, " << throughput << "M strings/s, " << speedup << "x"
+                << (same ? "" : "  RESULTS DIFFER") << std::endl;
+        }
+        std::cout << "Hardware threads: " << hardwareThreads << std::endl << std::endl;
+    };
+
+    auto incrementalSearch = [&candidates, &signatures, &sameResults](std::string const & pattern) {
+        // Type pattern one character at a time then backspace it. Compare against a full rescan per keystroke.
+        // The same search over a FuzzyCorpus must agree on every keystroke.
+        fts::FuzzyIncrementalSearch search(candidates.data(), signatures.data(), (int)candidates.size());
+        fts::FuzzyCorpus corpus(candidates.data(), (int)candidates.size());
+        fts::FuzzyIncrementalSearch corpusSearch(corpus.view());
+
+        auto step = [&](std::string const & typed) {
+            fts::Stopwatch stopwatch;
+            int count = search.set_pattern(typed.c_str());
+            auto incrementalTime = stopwatch.elapsedMillisecondsAndReset();
+
+            fts::FuzzyPattern full(typed.c_str());
+            int fullCount = 0;
+            for (size_t i = 0; i < candidates.size(); ++i)
+                if (full.might_match(signatures[i]) && full.match(candidates[i]))
+                    ++fullCount;
+            auto fullTime = stopwatch.elapsedMilliseconds();
+
+            const int k = 10;
+            std::vector<fts::FuzzyResult> arrayTop(k), corpusTop(k);
+            arrayTop.resize(search.top_k(k, arrayTop.data()));
+            bool corpusSame = corpusSearch.set_pattern(typed.c_str()) == count && corpusSearch.matches() == search.matches();
+            corpusTop.resize(corpusSearch.top_k(k, corpusTop.data()));
+            corpusSame = corpusSame && sameResults(arrayTop, corpusTop);
+
+            std::cout << "[" << typed << "] " << count << " matches, scanned " << search.last_scan_count() << " in " << incrementalTime
+                << "ms (full rescan " << fullTime << "ms)" << (count == fullCount ? "" : "  COUNT DIFFERS") << (corpusSame ? "" : "  CORPUS DIFFERS") << std::endl;
+        };
+
+        for (size_t len = 1; len <= pattern.size(); ++len)
+            step(pattern.substr(0, len));
+        for (size_t len = pattern.size(); len-- > 1;)
+            step(pattern.substr(0, len));
+        std::cout << std::endl;
+    };
+
+    auto scorerBenchmark = [&candidates](std::string const & pattern) {
+        // Time recursive scorer per pattern prefix and per match index type. Cost should grow with pattern length only.
+        const int runs = 5;
+        auto nanosPerString = [&](double milliseconds) { return milliseconds * 1000000.0 / (runs * (double)candidates.size()); };
+
+        for (size_t len = 1; len <= pattern.size(); ++len) {
+            std::string prefix = pattern.substr(0, len);
+            fts::Stopwatch stopwatch;
+            int count = 0;
+            for (int run = 0; run < runs; ++run) {
+                for (char const * candidate : candidates) {
+                    int score;
+                    if (fts::fuzzy_match(prefix.c_str(), candidate, score))
+                        ++count;
+                }
+            }
+            std::cout << "[" << prefix << "] " << nanosPerString(stopwatch.elapsedMilliseconds()) << "ns per string, " << count / runs << " matches" << std::endl;
+        }
+
+        uint8_t matches8[256];
+        uint32_t matches32[256];
+        fts::Stopwatch stopwatch;
+        for (int run = 0; run < runs; ++run) {
+            for (char const * candidate : candidates) {
+                int score;
+                fts::fuzzy_match(pattern.c_str(), candidate, score, matches8, sizeof(matches8));
+            }
+        }
+        auto time8 = stopwatch.elapsedMillisecondsAndReset();
+        for (int run = 0; run < runs; ++run) {
+            for (char const * candidate : candidates) {
+                int score;
+                fts::fuzzy_match(pattern.c_str(), candidate, score, matches32, 256);
+            }
+        }
+        auto time32 = stopwatch.elapsedMilliseconds();
+        std::cout << "uint8_t indices: " << nanosPerString(time8) << "ns per string" << std::endl;
+        std::cout << "uint32_t indices: " << nanosPerString(time32) << "ns per string" << std::endl;
+
+        // Subsequence test only. Vector skipping against the branch free Shift-And kernel.
+        fts::FuzzyPattern compiled(pattern.c_str());
+        int simpleCount = 0;
+        stopwatch.Reset();
+        for (int run = 0; run < runs; ++run)
+            for (char const * candidate : candidates)
+                simpleCount += compiled.match(candidate);
+        auto timeSimple = stopwatch.elapsedMillisecondsAndReset();
+        int bitCount = 0;
+        for (int run = 0; run < runs; ++run)
+            for (char const * candidate : candidates)
+                bitCount += compiled.match_bit_parallel(candidate);
+        auto timeBits = stopwatch.elapsedMilliseconds();
+        std::cout << "match: " << nanosPerString(timeSimple) << "ns per string, " << simpleCount / runs << " matches" << std::endl;
+        std::cout << "match_bit_parallel: " << nanosPerString(timeBits) << "ns per string, " << bitCount / runs << " matches" << std::endl << std::endl;
+    };
+
+    auto optimalMatches = [&dictionary](std::string const & pattern) {
+        std::vector<std::pair<int, std::string const*>> matches;
+        int score;
+        fts::FuzzyPattern compiled(pattern.c_str());
         for (auto && entry : dictionary)
-            if (fts::fuzzy_match(pattern.c_str(), entry.c_str(), score))
+            if (compiled.match_optimal(entry.c_str(), score))
                 matches.emplace_back(score, &entry);
 
         std::sort(matches.begin(), matches.end(), [](auto && a, auto && b) { return a.first > b.first; });
-        
+
         return matches;
     };
 
+    auto compareScorers = [&dictionary, &candidates](std::string const & pattern) {
+        // Run each scorer over the full dictionary then compare scores entry by entry
+        std::vector<int> recursiveScores(dictionary.size(), INT_MIN);
+        std::vector<int> optimalScores(dictionary.size(), INT_MIN);
+
+        fts::Stopwatch stopwatch;
+        for (size_t i = 0; i < dictionary.size(); ++i)
+            fts::fuzzy_match(pattern.c_str(), dictionary[i].c_str(), recursiveScores[i]);
+        auto recursiveTime = stopwatch.elapsedMillisecondsAndReset();
+
+        for (size_t i = 0; i < dictionary.size(); ++i)
+            fts::fuzzy_match_optimal(pattern.c_str(), dictionary[i].c_str(), optimalScores[i]);
+        auto optimalTime = stopwatch.elapsedMillisecondsAndReset();
+
+        // Same scores as fuzzy_match_optimal, several strings per SIMD step
+        std::vector<int> laneScores(dictionary.size());
+        fts::fuzzy_match_optimal_batch(pattern.c_str(), candidates.data(), (int)candidates.size(), laneScores.data());
+        auto batchTime = stopwatch.elapsedMilliseconds();
+
+        int batchDiffers = 0;
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            int expected = optimalScores[i] == INT_MIN ? fts::fuzzy_no_match : optimalScores[i];
+            if (laneScores[i] != expected)
+                ++batchDiffers;
+        }
+
+        // Pruned scoring with each entry's own score as minScore must reproduce it exactly. The fixed pair once scored
+        // higher because pruned branches left recursions free for branches fuzzy_match never reached.
+        fts::FuzzyPattern compiled(pattern.c_str());
+        int prunedDiffers = 0;
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            int score;
+            bool matched = compiled.match(dictionary[i].c_str(), score, recursiveScores[i]);
+            if (matched != (recursiveScores[i] != INT_MIN) || (matched && score != recursiveScores[i]))
+                ++prunedDiffers;
+        }
+        char const * fixedString = " BBbzzAzAaBzbcxA_Azzx_y z";
+        int fixedScore = INT_MIN;
+        int prunedScore = INT_MIN;
+        fts::fuzzy_match("bB", fixedString, fixedScore);
+        if (!fts::FuzzyPattern("bB").match(fixedString, prunedScore, fixedScore) || prunedScore != fixedScore)
+            ++prunedDiffers;
+
+        int improved = 0;
+        int missed = 0;
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            if (optimalScores[i] > recursiveScores[i]) {
+                ++improved;
+                if (recursiveScores[i] == INT_MIN)
+                    ++missed;
+            }
+        }
+
+        std::cout << "fuzzy_match:         " << recursiveTime << "ms" << std::endl;
+        std::cout << "fuzzy_match_optimal: " << optimalTime << "ms" << std::endl;
+        std::cout << "fuzzy_match_optimal_batch: " << batchTime << "ms (" << batchDiffers << " scores differ)" << std::endl;
+        std::cout << "FuzzyPattern::match with minScore: " << prunedDiffers << " scores differ" << std::endl;
+        std::cout << "Optimal scored higher on " << improved << " entries (" << missed << " not matched by fuzzy_match)" << std::endl << std::endl;
+    };
+
+    auto compareUtf8 = [&dictionary](std::string const & pattern) {
+        // Run byte and UTF-8 scorers over the full dictionary then list entries where they disagree
+        std::vector<int> byteScores(dictionary.size(), INT_MIN);
+        std::vector<int> utf8Scores(dictionary.size(), INT_MIN);
+
+        fts::Stopwatch stopwatch;
+        for (size_t i = 0; i < dictionary.size(); ++i)
+            fts::fuzzy_match(pattern.c_str(), dictionary[i].c_str(), byteScores[i]);
+        auto byteTime = stopwatch.elapsedMillisecondsAndReset();
+
+        for (size_t i = 0; i < dictionary.size(); ++i)
+            fts::fuzzy_match_utf8(pattern.c_str(), dictionary[i].c_str(), utf8Scores[i]);
+        auto utf8Time = stopwatch.elapsedMilliseconds();
+
+        const int maxPrinted = 20;
+        int differ = 0;
+        for (size_t i = 0; i < dictionary.size(); ++i) {
+            if (byteScores[i] != utf8Scores[i]) {
+                if (differ < maxPrinted)
+                    std::cout << "  " << dictionary[i] << "  bytes=" << byteScores[i] << " utf8=" << utf8Scores[i] << std::endl;
+                ++differ;
+            }
+        }
+
+        std::cout << "fuzzy_match:      " << byteTime << "ms" << std::endl;
+        std::cout << "fuzzy_match_utf8: " << utf8Time << "ms" << std::endl;
+        std::cout << "Scores differ on " << differ << " entries" << std::endl << std::endl;
+    };
+
+    auto corpusFile = [&candidates, &signatures, &path, &sameResults](std::string const & pattern) {
+        // Build a corpus file next to the text file, map it, and check it gives the same top 10 as the string array
+        // and an in-memory FuzzyCorpus
+        std::string corpusPath = path + ".corpus";
+        fts::Stopwatch stopwatch;
+        if (!fts::fuzzy_corpus_build(path.c_str(), corpusPath.c_str())) {
+            std::cout << "Failed to write [" << corpusPath << "]" << std::endl << std::endl;
+            return;
+        }
+        auto buildTime = stopwatch.elapsedMillisecondsAndReset();
+
+        fts::FuzzyCorpusFile file;
+        if (!file.open(corpusPath.c_str())) {
+            std::cout << "Failed to open [" << corpusPath << "]" << std::endl << std::endl;
+            return;
+        }
+        auto openTime = stopwatch.elapsedMillisecondsAndReset();
+
+        const int k = 10;
+        std::vector<fts::FuzzyResult> arrayResults(k);
+        int arrayCount = fts::fuzzy_match_top_k(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, arrayResults.data());
+        auto arrayTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::vector<fts::FuzzyResult> corpusResults(k);
+        int corpusCount = fts::fuzzy_match_top_k(pattern.c_str(), file.view(), k, corpusResults.data());
+        auto corpusTime = stopwatch.elapsedMilliseconds();
+
+        fts::FuzzyCorpus memory(candidates.data(), (int)candidates.size());
+        stopwatch.Reset();
+        std::vector<fts::FuzzyResult> memoryResults(k);
+        int memoryCount = fts::fuzzy_match_top_k(pattern.c_str(), memory.view(), k, memoryResults.data());
+        auto memoryTime = stopwatch.elapsedMillisecondsAndReset();
+
+        // Pooled corpus search sees strings out of order but must return exactly the serial results
+        fts::FuzzySearchPool pool(4);
+        stopwatch.Reset();
+        std::vector<fts::FuzzyResult> pooledResults(k);
+        int pooledCount = fts::fuzzy_match_top_k(pattern.c_str(), memory.view(), k, pooledResults.data(), pool);
+        auto pooledTime = stopwatch.elapsedMilliseconds();
+        memoryResults.resize(memoryCount);
+        pooledResults.resize(pooledCount);
+        bool pooledSame = sameResults(memoryResults, pooledResults);
+
+        // Only indices are compared. The corpus strips '\r' from CRLF files and scores shift by the unmatched letter.
+        bool same = arrayCount == corpusCount && arrayCount == memoryCount;
+        for (int i = 0; same && i < corpusCount; ++i)
+            same = arrayResults[i].index == corpusResults[i].index && arrayResults[i].index == memoryResults[i].index;
+
+        std::cout << "Wrote [" << corpusPath << "] " << file.file_size() << " bytes in " << buildTime << "ms" << std::endl;
+        std::cout << "Mapped " << file.view().count << " entries in " << openTime << "ms" << std::endl;
+        std::cout << "Top " << k << " from string array: " << arrayTime << "ms" << std::endl;
+        std::cout << "Top " << k << " from corpus file:  " << corpusTime << "ms" << std::endl;
+        std::cout << "Top " << k << " from FuzzyCorpus:  " << memoryTime << "ms" << std::endl;
+        std::cout << "Top " << k << " from FuzzyCorpus on " << pool.thread_count() << " threads: " << pooledTime << "ms, results " << (pooledSame ? "match" : "DIFFER") << std::endl;
+        std::cout << "Entries " << (same ? "match" : "DIFFER") << std::endl << std::endl;
+    };
+
+    auto bigramIndex = [&candidates, &sameResults](std::string const & pattern) {
+        // Build a bigram index over an in-memory corpus then compare indexed and scanned top 10
+        fts::FuzzyCorpus corpus(candidates.data(), (int)candidates.size());
+        fts::Stopwatch stopwatch;
+        fts::FuzzyBigramIndex index(corpus.view());
+        auto buildTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::vector<int> selected;
+        bool narrowed = index.candidates(pattern.c_str(), selected);
+        auto lookupTime = stopwatch.elapsedMillisecondsAndReset();
+
+        const int k = 10;
+        std::vector<fts::FuzzyResult> scanResults(k);
+        int scanCount = fts::fuzzy_match_top_k(pattern.c_str(), corpus.view(), k, scanResults.data());
+        auto scanTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::vector<fts::FuzzyResult> indexResults(k);
+        int indexCount = fts::fuzzy_match_top_k(pattern.c_str(), corpus.view(), index, k, indexResults.data());
+        auto indexTime = stopwatch.elapsedMilliseconds();
+
+        scanResults.resize(scanCount);
+        indexResults.resize(indexCount);
+        bool same = sameResults(scanResults, indexResults);
+
+        std::cout << "Built index in " << buildTime << "ms" << std::endl;
+        std::cout << "Postings: " << index.posting_count() << "  Memory: " << index.memory_bytes() / 1024 << "KB" << std::endl;
+        if (narrowed)
+            std::cout << "Candidates: " << selected.size() << " of " << corpus.size() << " in " << lookupTime << "ms" << std::endl;
+        else
+            std::cout << "Pattern has no pair to look up. Every string is a candidate." << std::endl;
+        std::cout << "Top " << k << " by scan:  " << scanTime << "ms" << std::endl;
+        std::cout << "Top " << k << " by index: " << indexTime << "ms" << std::endl;
+        std::cout << "Results " << (same ? "match" : "DIFFER") << std::endl << std::endl;
+    };
+
+    auto partitionedCorpus = [&candidates, &sameResults](std::string const & pattern) {
+        // Partition an in-memory corpus by length and first character then compare with a plain top 10 scan
+        fts::FuzzyCorpus corpus(candidates.data(), (int)candidates.size());
+        fts::Stopwatch stopwatch;
+        fts::FuzzyCorpusPartitions partitions(corpus.view());
+        auto buildTime = stopwatch.elapsedMillisecondsAndReset();
+
+        // Single worker pool gives the same exact scores as the partitioned search
+        fts::FuzzySearchPool pool(1);
+        const int k = 10;
+        stopwatch.Reset();
+        std::vector<fts::FuzzyResult> scanResults(k);
+        int scanCount = fts::fuzzy_match_top_k(pattern.c_str(), corpus.view(), k, scanResults.data(), pool);
+        auto scanTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::vector<fts::FuzzyResult> partitionResults(k);
+        int partitionCount = fts::fuzzy_match_top_k(pattern.c_str(), partitions, k, partitionResults.data());
+        auto partitionTime = stopwatch.elapsedMilliseconds();
+
+        scanResults.resize(scanCount);
+        partitionResults.resize(partitionCount);
+        bool same = sameResults(scanResults, partitionResults);
+
+        std::cout << "Built " << partitions.partition_count() << " partitions in " << buildTime << "ms" << std::endl;
+        std::cout << "Top " << k << " by scan:       " << scanTime << "ms" << std::endl;
+        std::cout << "Top " << k << " by partitions: " << partitionTime << "ms" << std::endl;
+        std::cout << "Results " << (same ? "match" : "DIFFER") << std::endl << std::endl;
+    };
+
+    auto multiPattern = [&dictionary, &candidates, &signatures, &sameResults](std::string const & patterns) {
+        // Space separated patterns. One top 10 scan per pattern against one pass for all of them.
+        std::vector<std::string> split;
+        size_t start = 0;
+        while (start < patterns.size()) {
+            size_t end = patterns.find(' ', start);
+            if (end == std::string::npos)
+                end = patterns.size();
+            if (end > start)
+                split.push_back(patterns.substr(start, end - start));
+            start = end + 1;
+        }
+
+        const int k = 10;
+        fts::Stopwatch stopwatch;
+        std::vector<std::vector<fts::FuzzyResult>> separate(split.size(), std::vector<fts::FuzzyResult>(k));
+        for (size_t p = 0; p < split.size(); ++p)
+            separate[p].resize(fts::fuzzy_match_top_k(split[p].c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, separate[p].data()));
+        auto separateTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::vector<char const *> patternPtrs;
+        for (auto && pattern : split)
+            patternPtrs.push_back(pattern.c_str());
+        fts::FuzzyMultiSearch multi(patternPtrs.data(), (int)patternPtrs.size());
+        std::vector<std::vector<fts::FuzzyResult>> together;
+        multi.top_k(candidates.data(), signatures.data(), (int)candidates.size(), k, together);
+        auto togetherTime = stopwatch.elapsedMilliseconds();
+
+        fts::FuzzyCorpus corpus(candidates.data(), (int)candidates.size());
+        stopwatch.Reset();
+        std::vector<std::vector<fts::FuzzyResult>> fromCorpus;
+        multi.top_k(corpus.view(), k, fromCorpus);
+        auto corpusTime = stopwatch.elapsedMilliseconds();
+
+        for (size_t p = 0; p < split.size(); ++p) {
+            bool same = sameResults(separate[p], together[p]) && sameResults(separate[p], fromCorpus[p]);
+            std::cout << "[" << split[p] << "] " << together[p].size() << " results";
+            if (!together[p].empty())
+                std::cout << ", best " << dictionary[together[p][0].index] << " (" << together[p][0].score << ")";
+            std::cout << (same ? "" : " DIFFER") << std::endl;
+        }
+        std::cout << "Separate scans: " << separateTime << "ms" << std::endl;
+        std::cout << "Single pass:    " << togetherTime << "ms" << std::endl;
+        std::cout << "FuzzyCorpus:    " << corpusTime << "ms" << std::endl << std::endl;
+    };
+
+    auto asyncSearch = [&candidates, &signatures, &sameResults](std::string const & pattern) {
+        // Time sliced top 10 with a 1ms budget per slice, then the same search on a background thread
+        const int k = 10;
+        std::vector<fts::FuzzyResult> expected(k);
+        expected.resize(fts::fuzzy_match_top_k(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), k, expected.data()));
+
+        fts::FuzzyAsyncSearch search(candidates.data(), signatures.data(), (int)candidates.size());
+        search.start(pattern.c_str(), k);
+        int slices = 0;
+        double longestSlice = 0;
+        fts::Stopwatch stopwatch;
+        bool finished = false;
+        while (!finished) {
+            fts::Stopwatch slice;
+            finished = search.step(1.0);
+            longestSlice = std::max(longestSlice, (double)slice.elapsedMilliseconds());
+            ++slices;
+        }
+        auto slicedTime = stopwatch.elapsedMillisecondsAndReset();
+
+        std::mutex mutex;
+        std::condition_variable completed;
+        bool called = false;
+        std::vector<fts::FuzzyResult> backgroundResults;
+        search.start(pattern.c_str(), k);
+        search.run_background([&](std::vector<fts::FuzzyResult> const & results) {
+            std::lock_guard<std::mutex> lock(mutex);
+            backgroundResults = results;
+            called = true;
+            completed.notify_one();
+        });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            completed.wait(lock, [&] { return called; });
+        }
+        auto backgroundTime = stopwatch.elapsedMilliseconds();
+
+        fts::FuzzyCorpus corpus(candidates.data(), (int)candidates.size());
+        fts::FuzzyAsyncSearch corpusSearch(corpus.view());
+        stopwatch.Reset();
+        corpusSearch.start(pattern.c_str(), k);
+        corpusSearch.flush();
+        auto corpusTime = stopwatch.elapsedMilliseconds();
+
+        std::cout << "Sliced: " << slices << " slices in " << slicedTime << "ms, longest slice " << longestSlice << "ms, results " << (sameResults(search.results(), expected) ? "match" : "DIFFER") << std::endl;
+        std::cout << "Background: " << backgroundTime << "ms, results " << (sameResults(backgroundResults, expected) ? "match" : "DIFFER") << std::endl;
+        std::cout << "FuzzyCorpus: " << corpusTime << "ms, results " << (sameResults(corpusSearch.results(), expected) ? "match" : "DIFFER") << std::endl << std::endl;
+    };
+
+    auto liveCorpus = [&candidates, &sameResults](std::string const & pattern) {
+        // Insert every string, remove every other one while searching, then compare with a scan of what is left
+        fts::FuzzyLiveCorpus live;
+        fts::Stopwatch stopwatch;
+        std::vector<int> ids;
+        ids.reserve(candidates.size());
+        for (auto && c : candidates)
+            ids.push_back(live.insert(c));
+        auto insertTime = stopwatch.elapsedMillisecondsAndReset();
+
+        const int k = 10;
+        std::vector<fts::FuzzyResult> results(k);
+        double longestSearch = 0;
+        for (size_t i = 0; i < ids.size(); i += 2) {
+            live.remove(ids[i]);
+            if (i % 4096 == 0) {
+                fts::Stopwatch search;
+                live.top_k(pattern.c_str(), k, results.data());
+                longestSearch = std::max(longestSearch, (double)search.elapsedMilliseconds());
+            }
+        }
+        auto removeTime = stopwatch.elapsedMillisecondsAndReset();
+        bool compacted = live.compacting();
+        live.wait();
+        auto compactTime = stopwatch.elapsedMillisecondsAndReset();
+
+        int count = live.top_k(pattern.c_str(), k, results.data());
+        auto searchTime = stopwatch.elapsedMilliseconds();
+
+        // Removed ids become empty strings so indices line up with ids
+        std::vector<char const *> remaining(candidates.size(), "");
+        std::vector<uint64_t> remainingSignatures(candidates.size(), fts::fuzzy_signature(""));
+        for (size_t i = 1; i < ids.size(); i += 2) {
+            remaining[ids[i]] = candidates[i];
+            remainingSignatures[ids[i]] = fts::fuzzy_signature(candidates[i]);
+        }
+        fts::FuzzySearchPool pool(1);
+        std::vector<fts::FuzzyResult> expected(k);
+        int expectedCount = pool.top_k(pattern.c_str(), remaining.data(), remainingSignatures.data(), (int)remaining.size(), k, expected.data());
+
+        results.resize(count);
+        expected.resize(expectedCount);
+        bool same = sameResults(results, expected);
+
+        std::cout << "Inserted " << ids.size() << " strings in " << insertTime << "ms" << std::endl;
+        std::cout << "Removed " << (ids.size() + 1) / 2 << " in " << removeTime << "ms, longest search meanwhile " << longestSearch << "ms" << std::endl;
+        if (compacted)
+            std::cout << "Compaction finished " << compactTime << "ms after the last removal" << std::endl;
+        std::cout << "Live: " << live.size() << "  Slots: " << live.slot_count() << std::endl;
+        std::cout << "Top " << k << ": " << searchTime << "ms, results " << (same ? "match" : "DIFFER") << std::endl << std::endl;
+    };
+
+    auto prefilterStats = [&candidates, &signatures, &scores](std::string const & pattern) {
+        // How many candidates are rejected by signature alone
+        fts::FuzzyPattern compiled(pattern.c_str());
+        int rejected = 0;
+        int scanned = 0;
+        int matched = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (!compiled.might_match(signatures[i])) {
+                ++rejected;
+                continue;
+            }
+            ++scanned;
+            if (compiled.match(candidates[i]))
+                ++matched;
+        }
+
+        // Scored batch with and without signatures
+        scores.resize(candidates.size());
+        fts::Stopwatch stopwatch;
+        fts::fuzzy_match_batch(pattern.c_str(), candidates.data(), (int)candidates.size(), scores.data());
+        auto plainTime = stopwatch.elapsedMillisecondsAndReset();
+        fts::fuzzy_match_batch(pattern.c_str(), candidates.data(), signatures.data(), (int)candidates.size(), scores.data());
+        auto prefilterTime = stopwatch.elapsedMilliseconds();
+
+        double rejectRate = candidates.empty() ? 0.0 : 100.0 * rejected / candidates.size();
+        std::cout << "Rejected by signature: " << rejected << " of " << candidates.size() << " (" << rejectRate << "%)" << std::endl;
+        std::cout << "Scanned: " << scanned << "  Matched: " << matched << "  False positives: " << (scanned - matched) << std::endl;
+        std::cout << "fuzzy_match_batch without signatures: " << plainTime << "ms" << std::endl;
+        std::cout << "fuzzy_match_batch with signatures:    " << prefilterTime << "ms" << std::endl << std::endl;
+    };
+
 
     // Open file
     using namespace std::string_literals;
-    std::string path = argc > 1 ? argv[1] : "no file specified"s;
+    path = argc > 1 ? argv[1] : "no file specified"s;
     std::cout << "Reading [" << path << "]" << std::endl;
     std::ifstream infile(path);
     if (!infile.good()) {
@@ -72,8 +653,18 @@ int main(int argc, char *argv[]) {
     while (std::getline(infile, entry))
         dictionary.push_back(std::move(entry));
 
+    candidates.reserve(dictionary.size());
+    for (auto && e : dictionary)
+        candidates.push_back(e.c_str());
+
     auto time = stopwatch.elapsedMilliseconds();
-    std::cout << "Read [" << dictionary.size() << "] entries in " << time << "ms" << std::endl << std::endl;
+    std::cout << "Read [" << dictionary.size() << "] entries in " << time << "ms" << std::endl;
+
+    stopwatch.Reset();
+    signatures.reserve(dictionary.size());
+    for (auto && e : dictionary)
+        signatures.push_back(fts::fuzzy_signature(e.c_str()));
+    std::cout << "Computed signatures in " << stopwatch.elapsedMilliseconds() << "ms" << std::endl << std::endl;
 
     // Input Loop
     std::string option;
@@ -84,12 +675,26 @@ int main(int argc, char *argv[]) {
         std::cout << "1. Count Matches" << std::endl;
         std::cout << "2. Print Matches (Alphabetical)" << std::endl;
         std::cout << "3. Print Matches (By Score)" << std::endl;
-        std::cout << "4. Exit" << std::endl << std::endl;
+        std::cout << "4. Print Matches (By Optimal Score)" << std::endl;
+        std::cout << "5. Compare Scorers" << std::endl;
+        std::cout << "6. Prefilter Stats" << std::endl;
+        std::cout << "7. Print Top 10 Matches (By Score)" << std::endl;
+        std::cout << "8. Parallel Scaling" << std::endl;
+        std::cout << "9. Incremental Search" << std::endl;
+        std::cout << "10. Scorer Micro-Benchmark" << std::endl;
+        std::cout << "11. Compare UTF-8" << std::endl;
+        std::cout << "12. Corpus File" << std::endl;
+        std::cout << "13. Bigram Index" << std::endl;
+        std::cout << "14. Partitioned Corpus" << std::endl;
+        std::cout << "15. Multi-Pattern Search (space separated)" << std::endl;
+        std::cout << "16. Async Search" << std::endl;
+        std::cout << "17. Live Corpus" << std::endl;
+        std::cout << "0. Exit" << std::endl << std::endl;
         std::cout << "> ";
         std::getline(std::cin, option);
         std::cout << std::endl;
 
-        if (option != "4") {
+        if (option != "0") {
 
             // Read pattern from std::cin
             std::cout << "Enter search pattern" << std::endl << std::endl << "> ";
@@ -124,8 +729,76 @@ int main(int argc, char *argv[]) {
                     std::cout << result.first << " - " << *result.second << std::endl;
                 std::cout << std::endl << "Found " << results.size() << " matches in " << time << "ms" << std::endl << std::endl;
             }
+            else if (option == "4") {
+                // Print Matches (By Optimal Score)
+                stopwatch.Reset();
+                auto results = optimalMatches(pattern);
+                time = stopwatch.elapsedMilliseconds();
+
+                for (auto && result : results)
+                    std::cout << result.first << " - " << *result.second << std::endl;
+                std::cout << std::endl << "Found " << results.size() << " matches in " << time << "ms" << std::endl << std::endl;
+            }
+            else if (option == "5") {
+                // Compare Scorers
+                compareScorers(pattern);
+            }
+            else if (option == "6") {
+                // Prefilter Stats
+                prefilterStats(pattern);
+            }
+            else if (option == "7") {
+                // Print Top 10 Matches (By Score)
+                stopwatch.Reset();
+                auto results = topMatches(pattern, 10);
+                time = stopwatch.elapsedMilliseconds();
+
+                for (auto && result : results)
+                    std::cout << result.score << " - " << highlight(pattern, dictionary[result.index]) << std::endl;
+                std::cout << std::endl << "Found top " << results.size() << " matches in " << time << "ms" << std::endl << std::endl;
+            }
+            else if (option == "8") {
+                // Parallel Scaling
+                parallelScaling(pattern);
+            }
+            else if (option == "9") {
+                // Incremental Search
+                incrementalSearch(pattern);
+            }
+            else if (option == "10") {
+                // Scorer Micro-Benchmark
+                scorerBenchmark(pattern);
+            }
+            else if (option == "11") {
+                // Compare UTF-8
+                compareUtf8(pattern);
+            }
+            else if (option == "12") {
+                // Corpus File
+                corpusFile(pattern);
+            }
+            else if (option == "13") {
+                // Bigram Index
+                bigramIndex(pattern);
+            }
+            else if (option == "14") {
+                // Partitioned Corpus
+                partitionedCorpus(pattern);
+            }
+            else if (option == "15") {
+                // Multi-Pattern Search
+                multiPattern(pattern);
+            }
+            else if (option == "16") {
+                // Async Search
+                asyncSearch(pattern);
+            }
+            else if (option == "17") {
+                // Live Corpus
+                liveCorpus(pattern);
+            }
         }
-        else if (option == "4") {
+        else if (option == "0") {
             // Quit
             done = true;
         }